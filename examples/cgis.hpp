@@ -46,11 +46,34 @@ struct cgi_info : public server_t::i_resource_t
                 m_json.f<json_name::json_2>()++;
                 m_json.f<json_name::json_3>()++;
 
-                st << m_json;
+                // Length is unknown before serialization, so response
+                // is sent chunked or delimited by connection close.
+                bool chunked = (ecl::web::version::HTTP10 != c.get_ver());
 
-                std::cout << m_json << std::endl;
+                if(!chunked)
+                {
+                    c.set_keep_alive(false);
+                }
 
-                st.flush();
+                ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+                ecl::web::set_content_type_header(st, ecl::web::content_type::APPLICATION_JSON);
+                ecl::web::set_connection_header(st, c.get_keep_alive());
+
+                if(chunked)
+                {
+                    ecl::web::set_chunked_header(st);
+                }
+
+                st << "\r\n";
+
+                if(chunked)
+                {
+                    st.begin_chunked();
+                }
+
+                st << m_json << ecl::end();
+
+                std::cout << m_json << std::endl;
 
                 return ecl::web::status_code::OK;
             }
@@ -62,6 +85,7 @@ struct cgi_info : public server_t::i_resource_t
             case ecl::web::method::OPTIONS : break;
             case ecl::web::method::TRACE   : break;
             case ecl::web::method::CONNECT : break;
+            case ecl::web::method::UNKNOWN : break;
         }
 
         return ecl::web::status_code::METHOD_NOT_ALLOWED;
@@ -86,13 +110,29 @@ struct cgi_settings : public server_t::i_resource_t
     {}
 
     virtual ecl::web::status_code on_request(
-            server_t::i_resource_t::stream_t&,
+            server_t::i_resource_t::stream_t& st,
             ecl::web::i_request_cache&        c
         )                                                      noexcept override
     {
         switch(c.get_met())
         {
-            case ecl::web::method::GET     : break;
+            case ecl::web::method::GET     :
+            {
+                for(ecl::web::url_param_t p : c.get_query())
+                {
+                    std::cout << p.first << " = " << p.second << std::endl;
+                }
+
+                ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+                ecl::web::set_connection_header(st, c.get_keep_alive());
+                ecl::web::set_content_length_header(st, 0);
+                st << "\r\n";
+
+                st.flush();
+
+                return ecl::web::status_code::OK;
+            }
+            break;
             case ecl::web::method::HEAD    : break;
             case ecl::web::method::PUT     : break;
             case ecl::web::method::DELETE  : break;
@@ -115,6 +155,7 @@ struct cgi_settings : public server_t::i_resource_t
             case ecl::web::method::OPTIONS : break;
             case ecl::web::method::TRACE   : break;
             case ecl::web::method::CONNECT : break;
+            case ecl::web::method::UNKNOWN : break;
             break;
         }
 
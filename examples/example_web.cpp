@@ -3,14 +3,11 @@
 #include <iostream>
 #include <iomanip>
 
-#include <sys/socket.h>
-#include <netdb.h>
-#include <unistd.h>
-#include <string.h>
-
 #include <ecl/name_type.hpp>
 #include <ecl/stream.hpp>
 #include <ecl/web.hpp>
+#include <ecl/web/event_loop.hpp>
+#include <ecl/web/file_resource.hpp>
 
 // include generated sources
 #include "web_resources/index_html.h"
@@ -41,6 +38,7 @@ namespace name
     ECL_DECL_NAME_TYPE_STRING(auth,             "/auth")
     ECL_DECL_NAME_TYPE_STRING(settings,         "/settings")
     ECL_DECL_NAME_TYPE_STRING(upload,           "/upload")
+    ECL_DECL_NAME_TYPE_STRING(files,            "/files/*")
 
     ECL_DECL_NAME_TYPE_STRING(page_400,         "/400.html")
     ECL_DECL_NAME_TYPE_STRING(page_403,         "/403.html")
@@ -48,16 +46,6 @@ namespace name
     ECL_DECL_NAME_TYPE_STRING(page_500,         "/500.html")
 } // namespace name
 
-static int new_sd = 0;
-
-void write_sock(const char* const buf, std::size_t size);
-
-void write_sock(const char* const buf, std::size_t size)
-{
-    std::cout << buf << std::endl;
-    send(new_sd, buf, size, 0);
-}
-
 // using server_t = ecl::web::server
 // <
 //     ecl::web::resource_table
@@ -89,10 +77,8 @@ void write_sock(const char* const buf, std::size_t size)
 //     RECV_BUFFER_SIZE
 // >;
 
-static char buffer[RECV_BUFFER_SIZE];
-
 [[ noreturn ]]
-void start_server(const char*);
+void start_server(const char*, const char*);
 
 int main(int argc, char* argv[])
 {
@@ -102,18 +88,21 @@ int main(int argc, char* argv[])
         port = argv[1];
     }
 
+    // Directory, that is served at /files/.
+    const char* files_root = "./examples/web_resources_src";
+    if(argc > 2)
+    {
+        files_root = argv[2];
+    }
+
     std::cout << "port: " << port << std::endl;
 
-    start_server(port);
+    start_server(port, files_root);
 }
 
-void start_server(const char* port)
+void start_server(const char* port, const char* files_root)
 {
-    int status;
-    struct addrinfo  host_info;
-    struct addrinfo* host_info_list;
-
-    static server_t server(write_sock);
+    static server_t server;
 //    (
 //          std::make_pair(name::page_400::name() , ecl::web::static_resource < resources::res_400_html_t    >())
 //        , std::make_pair(name::page_404::name() , ecl::web::static_resource < resources::res_404_html_t    >())
@@ -130,33 +119,46 @@ void start_server(const char* port)
 
     bool resource_result = true;
 
-    server_t::static_resource_t < resources::res_400_html_t    > res_400     ( ecl::web::content_type::TEXT_HTML       , ecl::web::status_code::BAD_REQUEST           );
-    server_t::static_resource_t < resources::res_404_html_t    > res_404     ( ecl::web::content_type::TEXT_HTML       , ecl::web::status_code::NOT_FOUND             );
-    server_t::static_resource_t < resources::res_500_html_t    > res_500     ( ecl::web::content_type::TEXT_HTML       , ecl::web::status_code::INTERNAL_SERVER_ERROR );
+    server_t::static_resource_t < resources::res_400_html_t    > res_400     ( ecl::web::status_code::BAD_REQUEST           );
+    server_t::static_resource_t < resources::res_404_html_t    > res_404     ( ecl::web::status_code::NOT_FOUND             );
+    server_t::static_resource_t < resources::res_500_html_t    > res_500     ( ecl::web::status_code::INTERNAL_SERVER_ERROR );
 
-    server_t::static_resource_t < resources::res_index_html_t  > res_index_1 ( ecl::web::content_type::TEXT_HTML       );
-    server_t::static_resource_t < resources::res_index_html_t  > res_index_2 ( ecl::web::content_type::TEXT_HTML       );
+    server_t::static_resource_t < resources::res_index_html_t  > res_index_1;
+    server_t::static_resource_t < resources::res_index_html_t  > res_index_2;
 
-    server_t::static_resource_t < resources::res_icon_png_t    > res_icon    ( ecl::web::content_type::IMAGE_PNG       );
-    server_t::static_resource_t < resources::res_favicon_png_t > res_favicon ( ecl::web::content_type::IMAGE_PNG       );
-    server_t::static_resource_t < resources::res_style_css_t   > res_style   ( ecl::web::content_type::TEXT_CSS        );
-    server_t::static_resource_t < resources::res_jquery_js_t   > res_jquery  ( ecl::web::content_type::TEXT_JAVASCRIPT );
+    server_t::static_resource_t < resources::res_icon_png_t    > res_icon;
+    server_t::static_resource_t < resources::res_favicon_png_t > res_favicon;
+    server_t::static_resource_t < resources::res_style_css_t   > res_style;
+    server_t::static_resource_t < resources::res_jquery_js_t   > res_jquery;
 
-    cgi_info c_info;
+    cgi_info     c_info;
+    cgi_settings c_settings;
+
+    // Info is rendered at most once a second, polling clients get copy.
+    ecl::web::cached_resource < server_t::stream_t > c_info_cached ( c_info, std::chrono::seconds(1) );
+
+    ecl::web::file_resource < server_t::stream_t > res_files ( files_root );
 
     resource_result &= server.attach_handler( res_400 );
     resource_result &= server.attach_handler( res_404 );
     resource_result &= server.attach_handler( res_500 );
 
-    resource_result &= server.attach_resource( name::index_1::name()  , res_index_1 );
-    resource_result &= server.attach_resource( name::index_2::name()  , res_index_2 );
+    resource_result &= server.attach_resource< name::index_1  >( res_index_1 );
+    resource_result &= server.attach_resource< name::index_2  >( res_index_2 );
+
+    resource_result &= server.attach_resource< name::icon     >( res_icon    );
+    resource_result &= server.attach_resource< name::favicon  >( res_favicon );
+    resource_result &= server.attach_resource< name::style    >( res_style   );
+    resource_result &= server.attach_resource< name::jquery   >( res_jquery  );
 
-    resource_result &= server.attach_resource( name::icon::name()     , res_icon    );
-    resource_result &= server.attach_resource( name::favicon::name()  , res_favicon );
-    resource_result &= server.attach_resource( name::style::name()    , res_style   );
-    resource_result &= server.attach_resource( name::jquery::name()   , res_jquery  );
+    resource_result &= server.attach_resource< name::info     >( c_info_cached );
+    resource_result &= server.attach_resource< name::settings >( c_settings  );
 
-    resource_result &= server.attach_resource( name::info::name()     , c_info      );
+    resource_result &= server.attach_resource< name::files    >( res_files   );
+
+    // Headers count, headers size, URL length, body size,
+    // request time and idle time in seconds.
+    server.set_limits({ 32, 4096, 512, 64 * 1024, 10, 30 });
 
     if(!resource_result)
     {
@@ -164,103 +166,19 @@ void start_server(const char* port)
         exit(1);
     }
 
-    memset(&host_info, 0, sizeof host_info);
-
-    std::cout << "Setting up the structs..."  << std::endl;
+    static ecl::web::event_loop<server_t, RECV_BUFFER_SIZE, SEND_BUFFER_SIZE> loop(server);
 
-    host_info.ai_family   = AF_UNSPEC;   // IP version not specified. Can be both.
-    host_info.ai_socktype = SOCK_STREAM; // Use SOCK_STREAM for TCP or SOCK_DGRAM for UDP.
-    host_info.ai_flags    = AI_PASSIVE;  // IP Wildcard
-
-    // Now fill up the linked list of host_info structs with google's address information.
-    status = getaddrinfo(NULL, port, &host_info, &host_info_list);
-    // getaddrinfo returns 0 on succes, or some other value when an error occured.
-    // (translated into human readable text by the gai_gai_strerror function).
-    if (status != 0)
+    if(!loop.open(port))
     {
-        std::cout << "getaddrinfo error" << gai_strerror(status) << std::endl;
-    }
-
-    std::cout << "Creating a socket..."  << std::endl;
-    int socketfd ; // The socket descripter
-    socketfd = socket(host_info_list->ai_family, host_info_list->ai_socktype,
-                      host_info_list->ai_protocol);
-    if (socketfd == -1)
-    {
-        std::cout << "socket error ";
+        std::cout << "Listen error!" << std::endl;
         exit(1);
     }
 
-    std::cout << "Binding socket..."  << std::endl;
-    // we use to make the setsockopt() function to make sure the port is not in use
-    // by a previous execution of our code. (see man page for more information)
-    int yes = 1;
-    status = setsockopt(socketfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(int));
-    status = bind(socketfd, host_info_list->ai_addr, host_info_list->ai_addrlen);
-    if (status == -1)
-    {
-        std::cout << "bind error" << std::endl;
-        exit(1);
-    }
+    std::cout << "Listening for connections at port " << loop.port() << "..." << std::endl;
 
-    std::cout << "Listen()ing for connections at port " << port << "..." << std::endl;
-    status =  listen(socketfd, 5);
-    if (status == -1)
-    {
-        std::cout << "listen error" << std::endl;
-        exit(1);
-    }
+    // Time limits of the server are counted in seconds.
+    loop.run(1000);
 
-    while(true)
-    {
-        memset(buffer, 0x00, sizeof(buffer));
-
-        struct sockaddr their_addr;
-        socklen_t addr_size = sizeof(their_addr);
-        new_sd = accept(socketfd, &their_addr, &addr_size);
-        if (new_sd == -1)
-        {
-            std::cout << "listen error" << std::endl ;
-        }
-        else
-        {
-            std::cout << "Connection accepted. Using new socketfd : "  <<  new_sd << std::endl;
-        }
-
-        std::cout << "Waiting to recieve data..."  << std::endl;
-        ssize_t bytes_recieved;
-        bytes_recieved = recv(new_sd, buffer, RECV_BUFFER_SIZE, 0);
-        // If no data arrives, the program will just wait here until some data arrives.
-        if (bytes_recieved == 0)
-        {
-            std::cout << "host shut down." << std::endl;
-        }
-        else if (bytes_recieved == -1)
-        {
-            std::cout << "recieve error!" << std::endl;
-        }
-
-        std::cout << bytes_recieved << " bytes recieved :" << std::endl;
-        buffer[bytes_recieved] = 0;
-        // for(ssize_t i = 0; i < bytes_recieved; ++i)
-        // {
-        //     if(std::isprint(buffer[i]))
-        //     {
-        //         std::cout << buffer[i];
-        //     }
-        //     else
-        //     {
-        //         std::cout << std::hex << std::setw(2) << std::setfill('0') << int(buffer[i]) << std::dec;
-        //     }
-        // }
-        // std::cout << std::endl;
-        std::cout << buffer << std::endl;
-
-        server.process_request(buffer, static_cast<std::size_t>(bytes_recieved));
-
-        close(new_sd);
-    }
-    // std::cout << "Stopping server..." << std::endl;
-    // freeaddrinfo(host_info_list);
-    // close(socketfd);
+    std::cout << "Event loop error!" << std::endl;
+    exit(1);
 }
@@ -2,9 +2,23 @@
 #define ECL_EXAMPLES_SERVER_HPP
 
 #include <ecl/web.hpp>
+#include <ecl/web/event_loop.hpp>
 
-#define RECV_BUFFER_SIZE 2048
+#define RECV_BUFFER_SIZE  2048
+#define SEND_BUFFER_SIZE  16384
+#define CONNECTIONS_COUNT 8
 
-using server_t = ecl::web::server<RECV_BUFFER_SIZE>;
+using server_t = ecl::web::server
+                 <
+                       RECV_BUFFER_SIZE
+                     , 1024
+                     , 32
+                     , 16
+                     , 40
+                     , CONNECTIONS_COUNT
+                     , 32
+                     , ecl::web::request_cache
+                     , ecl::web::socket_sink<SEND_BUFFER_SIZE>
+                 >;
 
 #endif // ECL_EXAMPLES_SERVER_HPP
@@ -90,15 +90,62 @@ using flush_function_t = std::function
                              void(const char* const buf, std::size_t size)
                          >;
 
+namespace detail
+{
+
+// Sink priority: write() of object, write() of pointed object, call.
+template<typename SINK>
+auto sink_write(SINK& s, const char* const buf, std::size_t size, int)
+    -> decltype(s.write(buf, size), void())
+{
+    s.write(buf, size);
+}
+
+template<typename SINK>
+auto sink_write(SINK& s, const char* const buf, std::size_t size, long)
+    -> decltype(s->write(buf, size), void())
+{
+    s->write(buf, size);
+}
+
+template<typename SINK>
+auto sink_write(SINK& s, const char* const buf, std::size_t size, ...)
+    -> decltype(s(buf, size), void())
+{
+    s(buf, size);
+}
+
+// Sinks, that may be empty (pointers, std::function), are tested before call.
+template<typename SINK>
+auto sink_is_set(const SINK& s, int) -> decltype(static_cast<bool>(s))
+{
+// For GCC 4.7. We can pass nullptr to stream. Check is needed.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Waddress"
+    return static_cast<bool>(s);
+#pragma GCC diagnostic pop
+}
+
+template<typename SINK>
+bool sink_is_set(const SINK&, ...)
+{
+    return true;
+}
+
+} // namespace detail
+
 /**
  * @brief Stream class.
  * @details Have fixed-size buffer. Have oveflow callback.
  *
  * @tparam BUFFER_SIZE Size of internal buffer in bytes.
- * @tparam FLUSH_F_PTR = nullptr Pointer to @ref flush_function_t
- * that will be called on internal buffer overflow.
+ * @tparam SINK = flush_function_t Receiver of data on flush and on internal
+ * buffer overflow: function pointer, functor, object with
+ * write(const char*, std::size_t) or pointer to such object.
+ * Concrete sink type lets the call be inlined, @ref flush_function_t
+ * accepts any callable.
  */
-template<std::size_t BUFFER_SIZE>
+template<std::size_t BUFFER_SIZE, typename SINK = flush_function_t>
 class stream
 {
 private:
@@ -116,7 +163,9 @@ private:
     }
 
 public:
-    explicit stream(flush_function_t  flush_function  = nullptr,
+    using sink_t = SINK;
+
+    explicit stream(sink_t            flush_function  = sink_t(),
                     const base        def_base        = base::d,
                     const std::size_t def_width       = 8)              noexcept
     :
@@ -130,17 +179,18 @@ public:
     /**
      * @brief Flush stream.
      * @details Flush stream. If flush callback specified, it would be called.
+     * Default @ref flush_function_t callback is called for empty stream too,
+     * other sinks are called only with data.
      */
     void flush()
     {
-        // For GCC 4.7. We can pass nullptr to stream. Check is needed.
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Waddress"
-        if(nullptr != m_flush_function)
+        const bool call = (0 != m_count) || std::is_same<sink_t, flush_function_t>::value;
+
+        if(call && detail::sink_is_set(m_flush_function, 0))
         {
-            m_flush_function(m_buf, m_count);
+            detail::sink_write(m_flush_function, m_buf, m_count, 0);
         }
-#pragma GCC diagnostic pop
+
         reset();
     }
 
@@ -149,7 +199,7 @@ public:
      *
      * @param Flush function pointer
      */
-    void set_flush_function(flush_function_t f)                         noexcept
+    void set_flush_function(sink_t f)                                   noexcept
     {
         m_flush_function = f;
     }
@@ -245,6 +295,39 @@ public:
         return *this;
     }
 
+    /**
+     * @brief Write raw data.
+     * @details Data, that fits into free space of the buffer, is copied.
+     * Otherwise buffered data is flushed and then data is passed
+     * to the flush function as separate block, without copying.
+     *
+     * @param d pointer to data.
+     * @param size size of data.
+     */
+    stream& write(const char* const d, std::size_t size)
+    {
+        if(size <= BUFFER_SIZE - m_count)
+        {
+            for(std::size_t i = 0; i < size; ++i)
+            {
+                m_buf[m_count + i] = d[i];
+            }
+
+            m_count += size;
+
+            return *this;
+        }
+
+        flush();
+
+        if((0 != size) && detail::sink_is_set(m_flush_function, 0))
+        {
+            detail::sink_write(m_flush_function, d, size, 0);
+        }
+
+        return *this;
+    }
+
     template<std::size_t N>
     stream& operator<< (const uint8_t(&d)[N])
     {
@@ -517,7 +600,7 @@ private:
     // can be used for all bases till 16.
     const char* m_alphabet = R"(0123456789abcdef)";
 
-    flush_function_t  m_flush_function { nullptr };
+    sink_t            m_flush_function {};
 
     char              m_num_buf[66] {};
     char              m_buf[BUFFER_SIZE + 1] {};
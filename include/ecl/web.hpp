@@ -2,9 +2,18 @@
 #define ECL_WEB_HPP
 
 #include <ecl/web/server.hpp>
+#include <ecl/web/cached_resource.hpp>
+#include <ecl/web/connection.hpp>
 #include <ecl/web/constants.hpp>
+#include <ecl/web/limits.hpp>
 #include <ecl/web/request_cache.hpp>
 #include <ecl/web/resource.hpp>
+#include <ecl/web/response_stream.hpp>
+#include <ecl/web/route_table.hpp>
+#include <ecl/web/router.hpp>
+#include <ecl/web/sse_resource.hpp>
 #include <ecl/web/types.hpp>
+#include <ecl/web/url_params.hpp>
+#include <ecl/web/websocket.hpp>
 
 #endif // ECL_WEB_HPP
@@ -0,0 +1,217 @@
+#ifndef ECL_WEB_CACHED_RESOURCE_HPP
+#define ECL_WEB_CACHED_RESOURCE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+#include <ecl/web/constants.hpp>
+#include <ecl/web/i_request_cache.hpp>
+#include <ecl/web/i_resource.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Decorator, that stores rendered responses of the resource to GET and
+// replays them, while they are younger than ttl and invalidate() wasn't
+// called. Response is stored for path with query, HTTP version and
+// Connection header, so it must depend on nothing else.
+// Only "200 OK" responses up to RESPONSE_SIZE bytes are stored, up to
+// ENTRIES_COUNT of them, least recently used one is replaced.
+// invalidate() may be called from any thread, other calls are not
+// synchronized.
+template
+<
+      typename    ST
+    , std::size_t ENTRIES_COUNT = 4
+    , std::size_t RESPONSE_SIZE = 2048
+    , std::size_t KEY_SIZE      = 128
+    , typename    CLOCK         = std::chrono::steady_clock
+>
+class cached_resource : public i_resource<ST>
+{
+public:
+    using clock_source_t = CLOCK;
+
+    cached_resource(i_resource<ST>&                   res,
+                    typename clock_source_t::duration ttl)              noexcept
+        : m_res ( res )
+        , m_ttl ( ttl )
+    {}
+
+    virtual ~cached_resource()                                 noexcept override
+    {}
+
+    virtual status_code on_request(ST&              st,
+                                   i_request_cache& cache)     noexcept override
+    {
+        char key[KEY_SIZE];
+
+        if((method::GET != cache.get_met()) || !make_key(cache, key))
+        {
+            return m_res.on_request(st, cache);
+        }
+
+        const auto     now        = clock_source_t::now();
+        const unsigned current    = m_version.load(std::memory_order_acquire);
+        const bool     keep_alive = cache.get_keep_alive();
+
+        entry* lru = &m_entries[0];
+
+        for(auto& e : m_entries)
+        {
+            if((0 != e.m_size)                     &&
+               (e.m_ver        == cache.get_ver()) &&
+               (e.m_keep_alive == keep_alive)      &&
+               (0 == std::strcmp(e.m_key, key)))
+            {
+                if((e.m_version == current) && (now - e.m_stored < m_ttl))
+                {
+                    e.m_used = ++m_used;
+
+                    cache.set_keep_alive(e.m_reply_keep_alive);
+                    st.write(e.m_response, e.m_size);
+                    st.flush();
+
+                    return status_code::OK;
+                }
+
+                // Outdated response is replaced.
+                lru = &e;
+                break;
+            }
+
+            if(e.m_used < lru->m_used)
+            {
+                lru = &e;
+            }
+        }
+
+        st.begin_capture(lru->m_response, RESPONSE_SIZE);
+
+        status_code result = m_res.on_request(st, cache);
+
+        // Last chunk, that connection adds later, must be stored too.
+        if(st.is_chunked())
+        {
+            st.end_chunked();
+        }
+
+        std::size_t size = st.end_capture();
+
+        lru->m_size = 0;
+
+        if(!is_error(result) && is_ok(lru->m_response, size))
+        {
+            std::strcpy(lru->m_key, key);
+            lru->m_size       = size;
+            lru->m_stored     = now;
+            lru->m_version    = current;
+            lru->m_ver        = cache.get_ver();
+            lru->m_keep_alive = keep_alive;
+            lru->m_used       = ++m_used;
+
+            // Resource may close connection, replayed response does too.
+            lru->m_reply_keep_alive = cache.get_keep_alive();
+        }
+
+        return result;
+    }
+
+    virtual bool on_body_begin(i_request_cache& cache)         noexcept override
+    {
+        return m_res.on_body_begin(cache);
+    }
+
+    virtual status_code on_body_chunk(i_request_cache& cache,
+                                      const char*      data,
+                                      std::size_t      size)   noexcept override
+    {
+        return m_res.on_body_chunk(cache, data, size);
+    }
+
+    virtual i_session<ST>* open_session(ST&              st,
+                                        i_request_cache& cache) noexcept override
+    {
+        return m_res.open_session(st, cache);
+    }
+
+    // Stored responses are not replayed anymore, call it, when state of
+    // the resource is changed.
+    void invalidate()                                                   noexcept
+    {
+        m_version.fetch_add(1, std::memory_order_release);
+    }
+
+private:
+    cached_resource(const cached_resource& other)                      = delete;
+    cached_resource& operator= (const cached_resource& other)          = delete;
+    cached_resource(const cached_resource&& other)                     = delete;
+    cached_resource& operator= (const cached_resource&& other)         = delete;
+
+    struct entry
+    {
+        using time_point_t = typename clock_source_t::time_point;
+
+        char         m_key[KEY_SIZE]           {};
+        char         m_response[RESPONSE_SIZE] {};
+        std::size_t  m_size                    { 0 };
+        time_point_t m_stored                  {};
+        unsigned     m_version                 { 0 };
+        version      m_ver                     { version::HTTP11 };
+        bool         m_keep_alive              { false };
+        bool         m_reply_keep_alive        { false };
+        std::size_t  m_used                    { 0 };
+    };
+
+    // "path?query", request is not cached, if key doesn't fit.
+    static bool make_key(i_request_cache& cache, char (&key)[KEY_SIZE]) noexcept
+    {
+        url_field_t path  = cache.get_url(url_field::PATH);
+        url_field_t query = cache.get_url(url_field::QUERY);
+
+        if(nullptr == path)
+        {
+            return false;
+        }
+
+        std::size_t path_size  = std::strlen(path);
+        std::size_t query_size = (nullptr != query) ? std::strlen(query) : 0;
+
+        if(path_size + 1 + query_size >= KEY_SIZE)
+        {
+            return false;
+        }
+
+        std::memcpy(key, path, path_size);
+        key[path_size] = '?';
+        std::memcpy(key + path_size + 1, (nullptr != query) ? query : "", query_size);
+        key[path_size + 1 + query_size] = 0;
+
+        return true;
+    }
+
+    // "HTTP/1.x 200 ..."
+    static bool is_ok(const char* response, std::size_t size)           noexcept
+    {
+        return (size > 12) && (0 == std::strncmp(response + 8, " 200 ", 5));
+    }
+
+    using duration_t = typename clock_source_t::duration;
+
+    i_resource<ST>&       m_res;
+    duration_t            m_ttl;
+    entry                 m_entries[ENTRIES_COUNT] {};
+    std::size_t           m_used                   { 0 };
+    std::atomic<unsigned> m_version                { 0 };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_CACHED_RESOURCE_HPP
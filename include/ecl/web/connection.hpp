@@ -0,0 +1,681 @@
+#ifndef ECL_WEB_CONNECTION_HPP
+#define ECL_WEB_CONNECTION_HPP
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+
+#include "http_parser.h"
+
+#include <ecl/stream.hpp>
+
+#include <ecl/web/types.hpp>
+#include <ecl/web/constants.hpp>
+#include <ecl/web/i_resource.hpp>
+#include <ecl/web/limits.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Per-socket state of the server: parser, request cache and output stream.
+// Resource and handler tables are owned by the server and shared by all
+// connections.
+template<typename SERVER>
+class connection
+{
+public:
+    using server_t        = SERVER;
+    using sink_t          = typename server_t::sink_t;
+    using stream_t        = typename server_t::stream_t;
+    using request_cache_t = typename server_t::request_cache_t;
+    using i_resource_t    = typename server_t::i_resource_t;
+    using i_session_t     = i_session<stream_t>;
+
+    connection()                                                        noexcept
+    {
+        http_parser_init(&m_parser, HTTP_REQUEST);
+        m_parser.data = this;
+    }
+
+    void open(server_t* srv, sink_t cb)                                 noexcept
+    {
+        m_server = srv;
+        m_stream.set_flush_function(cb);
+
+        restart();
+    }
+
+    // Drops all connection state except send callback, as if new socket
+    // was opened.
+    void restart()                                                      noexcept
+    {
+        close_session();
+
+        m_stream << ecl::rst();
+
+        m_cache.clear();
+        m_cache.shift(m_cache.get_raw_rq_size());
+        m_parsed = 0;
+        m_keep_alive = true;
+        m_in_message = false;
+        m_ticks = 0;
+
+        http_parser_init(&m_parser, HTTP_REQUEST);
+        m_parser.data = this;
+    }
+
+    void close()                                                        noexcept
+    {
+        close_session();
+
+        m_server = nullptr;
+        m_stream.set_flush_function(sink_t());
+    }
+
+    bool is_open()                                                const noexcept
+    {
+        return nullptr != m_server;
+    }
+
+    // False after response to a request, that asked to close the connection
+    // (or after an error). Caller should close the socket then.
+    bool is_keep_alive()                                          const noexcept
+    {
+        return m_keep_alive;
+    }
+
+    // Request must be received within request_ticks limit, connection
+    // without request is closed after idle_ticks. Request, that ran out of
+    // time, is answered with 408. Returns false, if connection should be
+    // closed.
+    bool tick()                                                         noexcept
+    {
+        if(!is_open() || !m_keep_alive)
+        {
+            return false;
+        }
+
+        // Session keeps connection as long as it needs.
+        if(nullptr != m_session)
+        {
+            return true;
+        }
+
+        const request_limits& l = m_server->get_limits();
+
+        ++m_ticks;
+
+        if(m_in_message)
+        {
+            if((0 != l.request_ticks) && (m_ticks > l.request_ticks))
+            {
+                reset(status_code::REQUEST_TIMEOUT);
+            }
+        }
+        else if((0 != l.idle_ticks) && (m_ticks > l.idle_ticks))
+        {
+            m_keep_alive = false;
+        }
+
+        return m_keep_alive;
+    }
+
+    // Received data, that is kept for the next request. Borrowing cache
+    // (zero_copy_request_cache) keeps it in the caller's buffer.
+    fragment_t get_pending()                                            noexcept
+    {
+        return fragment_t(m_cache.get_raw_rq(), m_cache.get_raw_rq_size());
+    }
+
+    // Request may be split to any number of fragments. Each completed
+    // message is dispatched to the server as soon as it is parsed.
+    void process_request(const char* buf, std::size_t buf_size)         noexcept
+    {
+        if(!is_open() || !m_keep_alive)
+        {
+            return;
+        }
+
+        if(nullptr != m_session)
+        {
+            pass_to_session(buf, buf_size);
+            return;
+        }
+
+        do
+        {
+            std::size_t cached = m_cache.cache(buf, buf_size);
+
+            buf      += cached;
+            buf_size -= cached;
+
+            status_code result = parse();
+            if(is_error(result))
+            {
+                reset(result);
+                return;
+            }
+
+            if((0 == cached) && (0 != buf_size) && (nullptr == m_session))
+            {
+                reset(status_code::REQUEST_ENTITY_TOO_LARGE);
+                return;
+            }
+        }
+        while(m_keep_alive && (0 != buf_size) && (nullptr == m_session));
+
+        if(0 != buf_size)
+        {
+            pass_to_session(buf, buf_size);
+        }
+    }
+
+private:
+    connection(const connection& other)                                = delete;
+    connection& operator= (const connection& other)                    = delete;
+    connection(const connection&& other)                               = delete;
+    connection& operator= (const connection&& other)                   = delete;
+
+    enum class element
+    {
+          NONE
+        , URL
+        , HEADER_FIELD
+        , HEADER_VALUE
+    };
+
+    // Parses all not yet parsed data in the cache.
+    // Parser pauses itself on every message complete, so message is
+    // dispatched and dropped from the cache before the next one is parsed.
+    status_code parse()                                                 noexcept
+    {
+        while(m_keep_alive && (nullptr == m_session) &&
+              (m_parsed < m_cache.get_raw_rq_size()))
+        {
+            m_parsed += http_parser_execute(&m_parser,
+                                            &m_s_parser_settings,
+                                            m_cache.get_raw_rq() + m_parsed,
+                                            m_cache.get_raw_rq_size() - m_parsed);
+
+            drop_streamed_body();
+
+            switch(HTTP_PARSER_ERRNO(&m_parser))
+            {
+                case HPE_OK:
+                break;
+                case HPE_PAUSED:
+                    http_parser_pause(&m_parser, 0);
+                    dispatch();
+                break;
+                default:
+                    return is_error(m_status) ? m_status
+                                              : status_code::BAD_REQUEST;
+            }
+        }
+
+        return status_code::OK;
+    }
+
+    // Streamed body is already passed to resource, so only headers of the
+    // message are kept in the cache. Its trailers aren't collected, as
+    // they are erased too.
+    void drop_streamed_body()                                           noexcept
+    {
+        if(!m_streaming || (0 == m_body_start) || (m_parsed <= m_body_start))
+        {
+            return;
+        }
+
+        if(m_cache.erase(m_body_start, m_parsed - m_body_start))
+        {
+            m_parsed = m_body_start;
+        }
+    }
+
+    void dispatch()                                                     noexcept
+    {
+        body_t body = m_cache.get_body();
+        char*  tail = const_cast<char*>(body.first) + body.second;
+        char   tail_char = 0;
+
+        // Body is not delimited in the raw request, terminate it only while
+        // resource is called: next pipelined message may start right there.
+        if(nullptr != body.first)
+        {
+            tail_char = *tail;
+            *tail = 0;
+        }
+
+        m_server->call_resource(m_stream, m_cache, m_resource);
+
+        // Resource may forget to finish chunked body.
+        if(m_stream.is_chunked())
+        {
+            m_stream.end_chunked();
+        }
+
+        if(nullptr != body.first)
+        {
+            *tail = tail_char;
+        }
+
+        m_keep_alive = m_cache.get_keep_alive();
+        m_in_message = false;
+        m_ticks      = 0;
+
+        // Session may look at the request, so it is opened before the
+        // request is dropped from the cache.
+        if(m_keep_alive && (nullptr != m_resource))
+        {
+            m_session = m_resource->open_session(m_stream, m_cache);
+        }
+
+        // Pipelined requests after the last one are dropped.
+        m_cache.shift(m_keep_alive ? m_parsed : m_cache.get_raw_rq_size());
+        m_parsed = 0;
+
+        if(nullptr != m_session)
+        {
+            start_session();
+        }
+    }
+
+    // Data, that followed the request, belongs to the session.
+    void start_session()                                                noexcept
+    {
+        std::size_t size = m_cache.get_raw_rq_size();
+
+        if(0 != size)
+        {
+            pass_to_session(m_cache.get_raw_rq(), size);
+        }
+
+        m_cache.clear();
+        m_cache.shift(m_cache.get_raw_rq_size());
+    }
+
+    void pass_to_session(const char* buf, std::size_t size)             noexcept
+    {
+        if((nullptr != m_session) && !m_session->on_data(m_stream, buf, size))
+        {
+            close_session();
+            m_keep_alive = false;
+        }
+    }
+
+    void close_session()                                                noexcept
+    {
+        i_session_t* s = m_session;
+        m_session = nullptr;
+
+        if(nullptr != s)
+        {
+            s->on_close(m_stream);
+        }
+    }
+
+    void reset(status_code code)                                        noexcept
+    {
+        m_cache.set_keep_alive(false);
+        m_server->call_handler(m_stream, m_cache, code);
+
+        m_keep_alive = false;
+        m_in_message = false;
+
+        m_cache.shift(m_cache.get_raw_rq_size());
+        m_parsed = 0;
+
+        http_parser_init(&m_parser, HTTP_REQUEST);
+        m_parser.data = this;
+    }
+
+    // Error is answered by reset(), when parser stops.
+    int fail(status_code code)                                          noexcept
+    {
+        m_status = code;
+        return -1;
+    }
+
+    bool is_exceeded(std::size_t value, std::size_t limit)        const noexcept
+    {
+        return (0 != limit) && (value > limit);
+    }
+
+    // Callbacks for one element may be called several times if it is split
+    // across fragments. Cache is contiguous, so parts are just concatenated.
+    void accumulate(element e, const char* at, std::size_t length)      noexcept
+    {
+        if((m_element == e) && (m_element_at + m_element_length == at))
+        {
+            m_element_length += length;
+            return;
+        }
+
+        commit();
+
+        m_element        = e;
+        m_element_at     = at;
+        m_element_length = length;
+    }
+
+    void commit()                                                       noexcept
+    {
+        if(element::NONE == m_element)
+        {
+            return;
+        }
+
+        // Empty element points at the next one, which would be cut off by
+        // the terminator.
+        if(0 == m_element_length)
+        {
+            m_element_at = "";
+        }
+        else
+        {
+            const_cast<char*>(m_element_at)[m_element_length] = 0;
+        }
+
+        switch(m_element)
+        {
+            case element::URL:
+                m_cache.set_url(m_element_at);
+            break;
+            case element::HEADER_FIELD:
+                m_hdr.first = m_element_at;
+                m_hdr_name  = to_header_name(m_element_at, m_element_length);
+            break;
+            case element::HEADER_VALUE:
+                m_hdr.second = m_element_at;
+                m_cache.set_hdr(m_hdr_name, m_hdr);
+            break;
+            case element::NONE:
+            break;
+        }
+
+        m_element = element::NONE;
+    }
+
+    int on_message_begin()
+    {
+        m_cache.clear();
+        m_element = element::NONE;
+
+        m_resource   = nullptr;
+        m_streaming  = false;
+        m_body_start = 0;
+        m_status     = status_code::OK;
+
+        m_in_message    = true;
+        m_ticks         = 0;
+        m_headers_count = 0;
+        m_headers_size  = 0;
+        m_body_size     = 0;
+
+        return 0;
+    }
+
+    int on_url(const char* at, std::size_t length)
+    {
+        accumulate(element::URL, at, length);
+
+        if(is_exceeded(m_element_length, m_server->get_limits().url_length))
+        {
+            return fail(status_code::REQUEST_URI_TOO_LONG);
+        }
+
+        return on_header_bytes(length);
+    }
+
+    int on_status(const char*, std::size_t)
+    {
+        return 0;
+    }
+
+    int on_header_field(const char* at, std::size_t length)
+    {
+        // Trailers of streamed body are dropped from the cache with it.
+        if(m_streaming)
+        {
+            return on_header_bytes(length);
+        }
+
+        if(element::HEADER_FIELD != m_element)
+        {
+            ++m_headers_count;
+        }
+
+        accumulate(element::HEADER_FIELD, at, length);
+
+        if(is_exceeded(m_headers_count, m_server->get_limits().headers_count))
+        {
+            return fail(status_code::REQUEST_HEADER_FIELDS_TOO_LARGE);
+        }
+
+        return on_header_bytes(length);
+    }
+
+    int on_header_value(const char* at, std::size_t length)
+    {
+        if(m_streaming)
+        {
+            return on_header_bytes(length);
+        }
+
+        accumulate(element::HEADER_VALUE, at, length);
+        return on_header_bytes(length);
+    }
+
+    int on_header_bytes(std::size_t length)
+    {
+        m_headers_size += length;
+
+        if(is_exceeded(m_headers_size, m_server->get_limits().headers_size))
+        {
+            return fail(status_code::REQUEST_HEADER_FIELDS_TOO_LARGE);
+        }
+
+        return 0;
+    }
+
+    int on_headers_complete()
+    {
+        commit();
+
+        m_cache.set_met(to_method(m_parser.method));
+        m_cache.set_ver(to_version(m_parser.http_major, m_parser.http_minor));
+        m_cache.set_keep_alive(0 != http_should_keep_alive(&m_parser));
+
+        // Declared body is refused before it is received.
+        if((0 == (m_parser.flags & F_CHUNKED)) &&
+           (ULLONG_MAX != m_parser.content_length) &&
+           is_exceeded(m_parser.content_length, m_server->get_limits().body_size))
+        {
+            return fail(status_code::REQUEST_ENTITY_TOO_LARGE);
+        }
+
+        m_resource  = m_server->find_resource(m_cache);
+        m_streaming = (nullptr != m_resource) && m_resource->on_body_begin(m_cache);
+
+        return 0;
+    }
+
+    // Chunked body parts are separated by chunk headers. They are moved
+    // over already parsed headers, so body is contiguous in the cache.
+    int on_body(const char* at, std::size_t length)
+    {
+        m_body_size += length;
+
+        if(is_exceeded(m_body_size, m_server->get_limits().body_size))
+        {
+            return fail(status_code::REQUEST_ENTITY_TOO_LARGE);
+        }
+
+        if(m_streaming)
+        {
+            return on_body_chunk(at, length);
+        }
+
+        body_t body = m_cache.get_body();
+
+        if(nullptr == body.first)
+        {
+            body = std::make_pair(at, length);
+        }
+        else
+        {
+            char* end = const_cast<char*>(body.first) + body.second;
+
+            if(end != at)
+            {
+                std::memmove(end, at, length);
+            }
+
+            body.second += length;
+        }
+
+        m_cache.set_body(body);
+
+        return 0;
+    }
+
+    int on_body_chunk(const char* at, std::size_t length)
+    {
+        if(0 == m_body_start)
+        {
+            m_body_start = at - m_cache.get_raw_rq();
+        }
+
+        m_status = m_resource->on_body_chunk(m_cache, at, length);
+
+        return is_error(m_status) ? 1 : 0;
+    }
+
+    int on_message_complete()
+    {
+        // Last trailer header is still pending.
+        commit();
+
+        http_parser_pause(&m_parser, 1);
+        return 0;
+    }
+
+    int on_chunk_header()
+    {
+        return 0;
+    }
+
+    int on_chunk_complete()
+    {
+        return 0;
+    }
+
+    static int on_message_begin_static    (http_parser* p)
+    {
+        return static_cast<connection*>(p->data)->on_message_begin();
+    }
+
+    static int on_url_static              (http_parser* p, const char* at, std::size_t length)
+    {
+        return static_cast<connection*>(p->data)->on_url(at, length);
+    }
+
+    static int on_status_static           (http_parser* p, const char* at, std::size_t length)
+    {
+        return static_cast<connection*>(p->data)->on_status(at, length);
+    }
+
+    static int on_header_field_static     (http_parser* p, const char* at, std::size_t length)
+    {
+        return static_cast<connection*>(p->data)->on_header_field(at, length);
+    }
+
+    static int on_header_value_static     (http_parser* p, const char* at, std::size_t length)
+    {
+        return static_cast<connection*>(p->data)->on_header_value(at, length);
+    }
+
+    static int on_headers_complete_static (http_parser* p)
+    {
+        return static_cast<connection*>(p->data)->on_headers_complete();
+    }
+
+    static int on_body_static             (http_parser* p, const char* at, std::size_t length)
+    {
+        return static_cast<connection*>(p->data)->on_body(at, length);
+    }
+
+    static int on_message_complete_static (http_parser* p)
+    {
+        return static_cast<connection*>(p->data)->on_message_complete();
+    }
+
+    static int on_chunk_header_static     (http_parser* p)
+    {
+        return static_cast<connection*>(p->data)->on_chunk_header();
+    }
+
+    static int on_chunk_complete_static   (http_parser* p)
+    {
+        return static_cast<connection*>(p->data)->on_chunk_complete();
+    }
+
+    // Settings hold callbacks only, so one instance serves every connection.
+    static const http_parser_settings m_s_parser_settings;
+
+    server_t*       m_server         { nullptr };
+
+    stream_t        m_stream         {};
+
+    http_parser     m_parser         {};
+    std::size_t     m_parsed         { 0 };
+    bool            m_keep_alive     { true };
+
+    element         m_element        { element::NONE };
+    const char*     m_element_at     { nullptr };
+    std::size_t     m_element_length { 0 };
+
+    header_t        m_hdr            {};
+    header_name     m_hdr_name       { header_name::UNKNOWN };
+
+    // Resource is found once headers are parsed.
+    i_resource_t*   m_resource       { nullptr };
+    bool            m_streaming      { false };
+    // Offset of the streamed body in the cache, 0 until first part.
+    std::size_t     m_body_start     { 0 };
+    status_code     m_status         { status_code::OK };
+    // Connection is taken over by the session after its response.
+    i_session_t*    m_session        { nullptr };
+
+    bool            m_in_message     { false };
+    std::size_t     m_ticks          { 0 };
+    std::size_t     m_headers_count  { 0 };
+    std::size_t     m_headers_size   { 0 };
+    std::size_t     m_body_size      { 0 };
+
+    request_cache_t m_cache          {};
+};
+
+template<typename SERVER>
+const http_parser_settings connection<SERVER>::m_s_parser_settings =
+{
+      connection<SERVER>::on_message_begin_static
+    , connection<SERVER>::on_url_static
+    , connection<SERVER>::on_status_static
+    , connection<SERVER>::on_header_field_static
+    , connection<SERVER>::on_header_value_static
+    , connection<SERVER>::on_headers_complete_static
+    , connection<SERVER>::on_body_static
+    , connection<SERVER>::on_message_complete_static
+    , connection<SERVER>::on_chunk_header_static
+    , connection<SERVER>::on_chunk_complete_static
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_CONNECTION_HPP
@@ -1,7 +1,10 @@
 #ifndef ECL_WEB_CONSTANTS_HPP
 #define ECL_WEB_CONSTANTS_HPP
 
+#include <cctype>
+#include <chrono>
 #include <cstddef>
+#include <cstring>
 
 #include <ecl/str_const.hpp>
 #include <ecl/web/types.hpp>
@@ -60,6 +63,7 @@ enum class status_code
     , UNSUPPORTED_MEDIA_TYPE
     , REQUEST_RANGE_NOT_SATISFIABLE
     , EXPECTATION_FAILED
+    , REQUEST_HEADER_FIELDS_TOO_LARGE
 
     , INTERNAL_SERVER_ERROR
     , NOT_IMPLEMENTED
@@ -79,6 +83,7 @@ enum class method
     , OPTIONS
     , TRACE
     , CONNECT
+    , UNKNOWN
 };
 
 enum class url_field
@@ -100,6 +105,33 @@ enum class header_name
     , CONTENT_ENCODING
     , ACCEPT_ENCODING
     , LOCATION
+    , CONNECTION
+    , ETAG
+    , IF_NONE_MATCH
+    , RANGE
+    , IF_RANGE
+    , CONTENT_RANGE
+    , TRANSFER_ENCODING
+    , HOST
+    , AUTHORIZATION
+    , COOKIE
+    , USER_AGENT
+    , ACCEPT
+    , EXPECT
+    , UPGRADE
+    , SEC_WEBSOCKET_KEY
+    , SEC_WEBSOCKET_VERSION
+    , SEC_WEBSOCKET_ACCEPT
+    , LAST_EVENT_ID
+    // Not a header, count of known headers.
+    , UNKNOWN
+};
+
+enum class range_status
+{
+      NONE
+    , SATISFIABLE
+    , NOT_SATISFIABLE
 };
 
 enum class content_type
@@ -112,12 +144,17 @@ enum class content_type
     , IMAGE_JPEG
     , IMAGE_X_ICON
     , IMAGE_GIF
+    , IMAGE_SVG
     , TEXT_PLAIN
+    , APPLICATION_OCTET_STREAM
+    , TEXT_EVENT_STREAM
 };
 
 enum class content_encoding
 {
-    GZIP
+      IDENTITY
+    , GZIP
+    , BR
 };
 
 static inline url_field to_url_field(int f)                             noexcept
@@ -137,6 +174,40 @@ static inline url_field to_url_field(int f)                             noexcept
      return url_field::UNKNOWN;
 }
 
+static inline method to_method(unsigned int m)                          noexcept
+{
+    switch(http_method(m))
+    {
+        case HTTP_GET     : return method::GET;
+        case HTTP_HEAD    : return method::HEAD;
+        case HTTP_PUT     : return method::PUT;
+        case HTTP_DELETE  : return method::DELETE;
+        case HTTP_POST    : return method::POST;
+        case HTTP_OPTIONS : return method::OPTIONS;
+        case HTTP_TRACE   : return method::TRACE;
+        case HTTP_CONNECT : return method::CONNECT;
+        default           : break;
+    }
+
+    return method::UNKNOWN;
+}
+
+static inline version to_version(unsigned short major,
+                                 unsigned short minor)                  noexcept
+{
+    if(2 == major)
+    {
+        return version::HTTP20;
+    }
+
+    if((1 == major) && (0 == minor))
+    {
+        return version::HTTP10;
+    }
+
+    return version::HTTP11;
+}
+
 static inline str_const to_string(url_field f)                          noexcept
 {
     switch(f)
@@ -206,6 +277,7 @@ static inline str_const to_string(status_code c)                        noexcept
         case status_code::UNSUPPORTED_MEDIA_TYPE:        return { "UNSUPPORTED_MEDIA_TYPE"        };
         case status_code::REQUEST_RANGE_NOT_SATISFIABLE: return { "REQUEST_RANGE_NOT_SATISFIABLE" };
         case status_code::EXPECTATION_FAILED:            return { "EXPECTATION_FAILED"            };
+        case status_code::REQUEST_HEADER_FIELDS_TOO_LARGE: return { "REQUEST_HEADER_FIELDS_TOO_LARGE" };
 
         case status_code::INTERNAL_SERVER_ERROR:         return { "INTERNAL_SERVER_ERROR"         };
         case status_code::NOT_IMPLEMENTED:               return { "NOT_IMPLEMENTED"               };
@@ -229,6 +301,7 @@ static inline str_const to_string(method m)                             noexcept
         case method::OPTIONS: return { "OPTIONS" };
         case method::TRACE:   return { "TRACE"   };
         case method::CONNECT: return { "CONNECT" };
+        case method::UNKNOWN: return { ""        };
     }
     return { "" };
 }
@@ -237,11 +310,30 @@ static inline str_const to_string(header_name n)                        noexcept
 {
     switch(n)
     {
-        case header_name::CONTENT_TYPE:     return { "Content-Type"     };
-        case header_name::CONTENT_LENGTH:   return { "Content-Length"   };
-        case header_name::CONTENT_ENCODING: return { "Content-Encoding" };
-        case header_name::ACCEPT_ENCODING:  return { "Accept-Encoding"  };
-        case header_name::LOCATION:         return { "Location"         };
+        case header_name::CONTENT_TYPE:          return { "Content-Type"          };
+        case header_name::CONTENT_LENGTH:        return { "Content-Length"        };
+        case header_name::CONTENT_ENCODING:      return { "Content-Encoding"      };
+        case header_name::ACCEPT_ENCODING:       return { "Accept-Encoding"       };
+        case header_name::LOCATION:              return { "Location"              };
+        case header_name::CONNECTION:            return { "Connection"            };
+        case header_name::ETAG:                  return { "ETag"                  };
+        case header_name::IF_NONE_MATCH:         return { "If-None-Match"         };
+        case header_name::RANGE:                 return { "Range"                 };
+        case header_name::IF_RANGE:              return { "If-Range"              };
+        case header_name::CONTENT_RANGE:         return { "Content-Range"         };
+        case header_name::TRANSFER_ENCODING:     return { "Transfer-Encoding"     };
+        case header_name::HOST:                  return { "Host"                  };
+        case header_name::AUTHORIZATION:         return { "Authorization"         };
+        case header_name::COOKIE:                return { "Cookie"                };
+        case header_name::USER_AGENT:            return { "User-Agent"            };
+        case header_name::ACCEPT:                return { "Accept"                };
+        case header_name::EXPECT:                return { "Expect"                };
+        case header_name::UPGRADE:               return { "Upgrade"               };
+        case header_name::SEC_WEBSOCKET_KEY:     return { "Sec-WebSocket-Key"     };
+        case header_name::SEC_WEBSOCKET_VERSION: return { "Sec-WebSocket-Version" };
+        case header_name::SEC_WEBSOCKET_ACCEPT:  return { "Sec-WebSocket-Accept"  };
+        case header_name::LAST_EVENT_ID:         return { "Last-Event-ID"         };
+        case header_name::UNKNOWN:               return { ""                      };
     }
     return { "" };
 }
@@ -258,7 +350,12 @@ static inline str_const to_string(content_type t)                       noexcept
         case content_type::IMAGE_JPEG:       return { "image/jpeg"       };
         case content_type::IMAGE_X_ICON:     return { "image/x-icon"     };
         case content_type::IMAGE_GIF:        return { "image/gif"        };
+        case content_type::IMAGE_SVG:        return { "image/svg+xml"    };
         case content_type::TEXT_PLAIN:       return { "text/plain"       };
+        case content_type::APPLICATION_OCTET_STREAM:
+                                             return { "application/octet-stream" };
+        case content_type::TEXT_EVENT_STREAM:
+                                             return { "text/event-stream" };
     }
     return { "" };
 }
@@ -267,7 +364,9 @@ static inline str_const to_string(content_encoding e)                   noexcept
 {
     switch(e)
     {
-        case content_encoding::GZIP: return { "gzip" }; break;
+        case content_encoding::IDENTITY: return { "identity" }; break;
+        case content_encoding::GZIP:     return { "gzip"     }; break;
+        case content_encoding::BR:       return { "br"       }; break;
     }
     return { "" };
 }
@@ -313,6 +412,7 @@ static inline uint32_t to_int(status_code c)                            noexcept
         case status_code::UNSUPPORTED_MEDIA_TYPE:        return 415;
         case status_code::REQUEST_RANGE_NOT_SATISFIABLE: return 416;
         case status_code::EXPECTATION_FAILED:            return 417;
+        case status_code::REQUEST_HEADER_FIELDS_TOO_LARGE: return 431;
 
         case status_code::INTERNAL_SERVER_ERROR:         return 500;
         case status_code::NOT_IMPLEMENTED:               return 501;
@@ -365,6 +465,7 @@ static inline bool is_error(status_code c)                              noexcept
         case status_code::UNSUPPORTED_MEDIA_TYPE:        return true;
         case status_code::REQUEST_RANGE_NOT_SATISFIABLE: return true;
         case status_code::EXPECTATION_FAILED:            return true;
+        case status_code::REQUEST_HEADER_FIELDS_TOO_LARGE: return true;
 
         case status_code::INTERNAL_SERVER_ERROR:         return true;
         case status_code::NOT_IMPLEMENTED:               return true;
@@ -412,6 +513,321 @@ static void set_content_encoding_header(T& st, content_encoding e)      noexcept
        << to_string(e) << "\r\n";
 }
 
+template<typename T>
+static void set_content_length_header(T& st, std::size_t length)       noexcept
+{
+    st << to_string(header_name::CONTENT_LENGTH)
+       << ":"
+       << length << "\r\n";
+}
+
+template<typename T>
+static void set_connection_header(T& st, bool keep_alive)               noexcept
+{
+    st << to_string(header_name::CONNECTION)
+       << ":"
+       << (keep_alive ? "keep-alive" : "close") << "\r\n";
+}
+
+template<typename T>
+static void set_chunked_header(T& st)                                   noexcept
+{
+    st << to_string(header_name::TRANSFER_ENCODING)
+       << ":chunked\r\n";
+}
+
+template<typename T>
+static void set_etag_header(T& st, const char* etag)                    noexcept
+{
+    st << to_string(header_name::ETAG)
+       << ":"
+       << etag << "\r\n";
+}
+
+template<typename T>
+static void set_content_range_header(T& st,
+                                     range_t     r,
+                                     std::size_t size)                  noexcept
+{
+    st << to_string(header_name::CONTENT_RANGE)
+       << ":bytes "
+       << r.first << "-" << r.first + r.second - 1 << "/" << size << "\r\n";
+}
+
+template<typename T>
+static void set_unsatisfied_range_header(T& st, std::size_t size)       noexcept
+{
+    st << to_string(header_name::CONTENT_RANGE)
+       << ":bytes */" << size << "\r\n";
+}
+
+// Header names are case-insensitive.
+static inline int header_name_cmp(header_name_t a, header_name_t b)     noexcept
+{
+    using uchar_t = unsigned char;
+
+    for(; (0 != *a) && (std::tolower(uchar_t(*a)) == std::tolower(uchar_t(*b))); ++a, ++b)
+    {}
+
+    return std::tolower(uchar_t(*a)) - std::tolower(uchar_t(*b));
+}
+
+constexpr char header_name_lower(char c)                                noexcept
+{
+    return ((c >= 'A') && (c <= 'Z')) ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Compares length chars of name with NUL-terminated known name.
+constexpr bool header_name_equal(const char* name,
+                                 std::size_t length,
+                                 const char* known)                     noexcept
+{
+    return (0 == length) ? (0 == *known)
+                         : ((0 != *known)                                      &&
+                            (header_name_lower(*name) == header_name_lower(*known)) &&
+                            header_name_equal(name + 1, length - 1, known + 1));
+}
+
+// Name is not required to be NUL-terminated, so it can be matched right
+// in the parser callback.
+static inline header_name to_header_name(const char* name,
+                                         std::size_t length)            noexcept
+{
+    for(int i = 0; i < static_cast<int>(header_name::UNKNOWN); ++i)
+    {
+        const header_name n = static_cast<header_name>(i);
+        const str_const&  s = to_string(n);
+
+        if((s.size() == length) && header_name_equal(name, length, s))
+        {
+            return n;
+        }
+    }
+
+    return header_name::UNKNOWN;
+}
+
+// Same mapping as res_gen.sh uses, but unknown files are binary.
+static inline content_type to_content_type(const char* path)             noexcept
+{
+    static const struct
+    {
+        const char*  m_ext;
+        content_type m_type;
+    } types[] =
+    {
+          { "html", content_type::TEXT_HTML        }
+        , { "htm",  content_type::TEXT_HTML        }
+        , { "css",  content_type::TEXT_CSS         }
+        , { "js",   content_type::TEXT_JAVASCRIPT  }
+        , { "json", content_type::APPLICATION_JSON }
+        , { "png",  content_type::IMAGE_PNG        }
+        , { "jpg",  content_type::IMAGE_JPEG       }
+        , { "jpeg", content_type::IMAGE_JPEG       }
+        , { "gif",  content_type::IMAGE_GIF        }
+        , { "ico",  content_type::IMAGE_X_ICON     }
+        , { "svg",  content_type::IMAGE_SVG        }
+        , { "txt",  content_type::TEXT_PLAIN       }
+    };
+
+    const char* ext = std::strrchr(path, '.');
+    if((nullptr == ext) || (nullptr != std::strchr(ext, '/')))
+    {
+        return content_type::APPLICATION_OCTET_STREAM;
+    }
+
+    for(const auto& t : types)
+    {
+        if(0 == header_name_cmp(ext + 1, t.m_ext))
+        {
+            return t.m_type;
+        }
+    }
+
+    return content_type::APPLICATION_OCTET_STREAM;
+}
+
+// Media type, that res_gen.sh writes to generated resources, as enum.
+static inline content_type mime_to_content_type(const char* mime)       noexcept
+{
+    for(int i = 0; i <= static_cast<int>(content_type::TEXT_EVENT_STREAM); ++i)
+    {
+        const content_type t = static_cast<content_type>(i);
+
+        if(0 == header_name_cmp(mime, to_string(t)))
+        {
+            return t;
+        }
+    }
+
+    return content_type::APPLICATION_OCTET_STREAM;
+}
+
+// Checks Accept-Encoding list for the coding, "*" covers codings that are
+// not listed. Coding is refused with zero quality value.
+// Identity is always acceptable, unless it is refused explicitly.
+static inline bool is_encoding_accepted(header_value_t   accepted,
+                                        content_encoding e)             noexcept
+{
+    using uchar_t = unsigned char;
+
+    if(nullptr == accepted)
+    {
+        return content_encoding::IDENTITY == e;
+    }
+
+    const char* coding = to_string(e);
+    std::size_t length = std::strlen(coding);
+    int         any    = (content_encoding::IDENTITY == e) ? 1 : 0;
+
+    for(const char* p = accepted; 0 != *p; )
+    {
+        p += std::strspn(p, " \t,");
+
+        std::size_t token = std::strcspn(p, " \t;,");
+        if(0 == token)
+        {
+            p += std::strcspn(p, ",");
+            continue;
+        }
+
+        const char* params = p + token;
+        const char* next   = params + std::strcspn(params, ",");
+        bool        q_zero = false;
+
+        // q=0, q=0.0, q=0.00 ...
+        const char* q = std::strstr(params, "q=");
+        if((nullptr != q) && (q < next) && ('0' == q[2]))
+        {
+            q     += 3;
+            q     += ('.' == *q) ? 1 : 0;
+            q     += std::strspn(q, "0");
+            q_zero = !std::isdigit(uchar_t(*q));
+        }
+
+        bool listed = (token == length);
+        for(std::size_t i = 0; listed && (i < length); ++i)
+        {
+            listed = std::tolower(uchar_t(p[i])) == coding[i];
+        }
+
+        if(listed)
+        {
+            return !q_zero;
+        }
+
+        if((1 == token) && ('*' == *p))
+        {
+            any = q_zero ? 0 : 1;
+        }
+
+        p = next;
+    }
+
+    return 0 != any;
+}
+
+// Checks comma-separated header value (Connection, Upgrade) for the token.
+// Tokens are case-insensitive.
+static inline bool has_header_token(header_value_t value,
+                                    const char*    token)               noexcept
+{
+    using uchar_t = unsigned char;
+
+    if(nullptr == value)
+    {
+        return false;
+    }
+
+    std::size_t length = std::strlen(token);
+
+    for(const char* p = value; 0 != *p; )
+    {
+        p += std::strspn(p, " \t,");
+
+        std::size_t size = std::strcspn(p, " \t,");
+        bool        same = (size == length);
+
+        for(std::size_t i = 0; same && (i < length); ++i)
+        {
+            same = std::tolower(uchar_t(p[i])) == std::tolower(uchar_t(token[i]));
+        }
+
+        if(same)
+        {
+            return true;
+        }
+
+        p += size;
+    }
+
+    return false;
+}
+
+// Value of hex digit, -1 for other chars.
+static inline int hex_digit(char c)                                     noexcept
+{
+    return ((c >= '0') && (c <= '9')) ? c - '0'      :
+           ((c >= 'a') && (c <= 'f')) ? c - 'a' + 10 :
+           ((c >= 'A') && (c <= 'F')) ? c - 'A' + 10 : -1;
+}
+
+// Byte, escaped as "%XY" at p, or -1, if it isn't valid escape before end.
+// Escaped NUL ("%00") is not decoded, so decoded string isn't cut by it.
+static inline int percent_decode(const char* p, const char* end)        noexcept
+{
+    if((end - p < 3) || ('%' != *p) || (hex_digit(p[1]) < 0) || (hex_digit(p[2]) < 0))
+    {
+        return -1;
+    }
+
+    int c = hex_digit(p[1]) * 16 + hex_digit(p[2]);
+
+    return (0 == c) ? -1 : c;
+}
+
+// If-None-Match may hold list of tags, weak tags or "*".
+// Weak comparison is used, as it is required for If-None-Match.
+static inline bool is_not_modified(header_value_t if_none_match,
+                                   const char*    etag)                 noexcept
+{
+    return (nullptr != if_none_match) &&
+           ((0 == std::strcmp(if_none_match, "*")) ||
+            (nullptr != std::strstr(if_none_match, etag)));
+}
+
+// Range is ignored, if If-Range doesn't match current entity.
+static inline bool is_range_valid(header_value_t if_range,
+                                  const char*    etag)                  noexcept
+{
+    return (nullptr == if_range) || (0 == std::strcmp(if_range, etag));
+}
+
+// 416 for entity, that is size bytes long.
+template<typename T>
+static void write_range_not_satisfiable(T&          st,
+                                        version     ver,
+                                        bool        keep_alive,
+                                        std::size_t size)               noexcept
+{
+    write_status_line(st, ver, status_code::REQUEST_RANGE_NOT_SATISFIABLE);
+    set_connection_header(st, keep_alive);
+    set_unsatisfied_range_header(st, size);
+    set_content_length_header(st, 0);
+    st << "\r\n";
+
+    st.flush();
+}
+
+// Monotonic time for timeouts and revalidation.
+static inline long monotonic_ms()                                       noexcept
+{
+    using namespace std::chrono;
+
+    return static_cast<long>(
+        duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
 template<typename T>
 static void redirect(T& st, const char* location, version ver)          noexcept
 {
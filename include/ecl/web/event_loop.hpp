@@ -0,0 +1,696 @@
+#ifndef ECL_WEB_EVENT_LOOP_HPP
+#define ECL_WEB_EVENT_LOOP_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <ecl/web/constants.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Output of non-blocking client socket. Data, that socket doesn't take, is
+// buffered up to SEND_BUFFER_SIZE, output fails, if buffer overflows.
+// File or static data, that socket doesn't take, is sent later, and data,
+// written after it, is buffered until they are sent.
+// Output, opened with epoll descriptor, switches the socket to EPOLLOUT
+// itself, when data is left pending, so data, that sessions push outside
+// of socket events, doesn't wait for the next tick.
+template<std::size_t SEND_BUFFER_SIZE>
+class socket_output
+{
+public:
+    socket_output()                                                     noexcept
+    {}
+
+    ~socket_output()                                                    noexcept
+    {
+        close();
+    }
+
+    void open(int fd, int epoll = -1, void* data = nullptr)             noexcept
+    {
+        close();
+
+        m_fd     = fd;
+        m_failed = false;
+        m_begin  = 0;
+        m_size   = 0;
+        m_epoll  = epoll;
+        m_data   = data;
+        m_events = EPOLLIN;
+
+        m_static      = nullptr;
+        m_static_size = 0;
+    }
+
+    // Drops pending data, socket is closed by owner.
+    void close()                                                        noexcept
+    {
+        if(-1 != m_file)
+        {
+            ::close(m_file);
+            m_file = -1;
+        }
+
+        m_fd    = -1;
+        m_epoll = -1;
+    }
+
+    bool is_failed()                                              const noexcept
+    {
+        return m_failed;
+    }
+
+    bool is_pending()                                             const noexcept
+    {
+        return (0 != m_size) || (-1 != m_file) || (0 != m_static_size);
+    }
+
+    // Events of the socket, that epoll waits for.
+    void watch(uint32_t events)                                         noexcept
+    {
+        if((-1 == m_epoll) || (events == m_events))
+        {
+            return;
+        }
+
+        epoll_event ev {};
+        ev.events   = events;
+        ev.data.ptr = m_data;
+
+        epoll_ctl(m_epoll, EPOLL_CTL_MOD, m_fd, &ev);
+        m_events = events;
+    }
+
+    void write(const char* buf, std::size_t size)                       noexcept
+    {
+        if(m_failed)
+        {
+            return;
+        }
+
+        if(!is_pending())
+        {
+            std::size_t sent = send(buf, size);
+
+            buf  += sent;
+            size -= sent;
+        }
+
+        if(0 == size)
+        {
+            watch_pending();
+            return;
+        }
+
+        if(size > SEND_BUFFER_SIZE - m_size)
+        {
+            m_failed = true;
+            watch_pending();
+            return;
+        }
+
+        std::memmove(m_buf, m_buf + m_begin, m_size);
+        std::memcpy(m_buf + m_size, buf, size);
+
+        m_begin  = 0;
+        m_size  += size;
+
+        watch_pending();
+    }
+
+    // File is taken only if nothing is pending, so it is sent before data,
+    // buffered after it. Descriptor is duplicated, caller may close it.
+    bool send_file(int fd, std::size_t offset, std::size_t size)        noexcept
+    {
+        if(m_failed)
+        {
+            return true;
+        }
+
+        if(is_pending())
+        {
+            return false;
+        }
+
+        m_file_offset = static_cast<off_t>(offset);
+        m_file_size   = size;
+
+        send_file_part(fd);
+
+        if(!m_failed && (0 != m_file_size))
+        {
+            m_file   = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+            m_failed = (-1 == m_file);
+        }
+
+        watch_pending();
+
+        return true;
+    }
+
+    // Data must stay valid until it is sent (static resource data), so
+    // it is not copied to the buffer. Taken only if nothing is pending,
+    // same as file.
+    bool send_static(const char* buf, std::size_t size)                 noexcept
+    {
+        if(m_failed)
+        {
+            return true;
+        }
+
+        if(is_pending())
+        {
+            return false;
+        }
+
+        std::size_t sent = send(buf, size);
+
+        m_static      = buf  + sent;
+        m_static_size = size - sent;
+
+        watch_pending();
+
+        return true;
+    }
+
+    // Sends pending file, static data and buffered data, that socket
+    // takes now.
+    void flush()                                                        noexcept
+    {
+        if(-1 != m_file)
+        {
+            send_file_part(m_file);
+
+            if(m_failed || (0 != m_file_size))
+            {
+                return;
+            }
+
+            ::close(m_file);
+            m_file = -1;
+        }
+
+        if(0 != m_static_size)
+        {
+            std::size_t sent = send(m_static, m_static_size);
+
+            m_static      += sent;
+            m_static_size -= sent;
+
+            if(0 != m_static_size)
+            {
+                return;
+            }
+        }
+
+        std::size_t sent = send(m_buf + m_begin, m_size);
+
+        m_begin += sent;
+        m_size  -= sent;
+    }
+
+private:
+    socket_output(const socket_output& other)                          = delete;
+    socket_output& operator= (const socket_output& other)              = delete;
+    socket_output(const socket_output&& other)                         = delete;
+    socket_output& operator= (const socket_output&& other)             = delete;
+
+    // Failed output is reported by EPOLLOUT too, so owner drops it.
+    void watch_pending()                                                noexcept
+    {
+        if(m_failed || is_pending())
+        {
+            watch(EPOLLOUT);
+        }
+    }
+
+    // Returns count of sent bytes, fails output on socket error.
+    std::size_t send(const char* buf, std::size_t size)                 noexcept
+    {
+        ssize_t sent = ::send(m_fd, buf, size, MSG_NOSIGNAL);
+
+        if(sent < 0)
+        {
+            m_failed = (EAGAIN != errno) && (EWOULDBLOCK != errno);
+            return 0;
+        }
+
+        return static_cast<std::size_t>(sent);
+    }
+
+    void send_file_part(int file)                                       noexcept
+    {
+        while(0 != m_file_size)
+        {
+            ssize_t sent = sendfile(m_fd, file, &m_file_offset, m_file_size);
+
+            // File is shorter than expected, if nothing is sent.
+            if(sent <= 0)
+            {
+                m_failed = (0 == sent) || ((EAGAIN != errno) && (EWOULDBLOCK != errno));
+                return;
+            }
+
+            m_file_size -= static_cast<std::size_t>(sent);
+        }
+    }
+
+    int         m_fd                   { -1 };
+    int         m_epoll                { -1 };
+    void*       m_data                 { nullptr };
+    uint32_t    m_events               { 0 };
+    bool        m_failed               { false };
+    std::size_t m_begin                { 0 };
+    std::size_t m_size                 { 0 };
+    int         m_file                 { -1 };
+    off_t       m_file_offset          { 0 };
+    std::size_t m_file_size            { 0 };
+    const char* m_static               { nullptr };
+    std::size_t m_static_size          { 0 };
+    char        m_buf[SEND_BUFFER_SIZE] {};
+};
+
+// Sink of connections, that event_loop opens. Server, declared with this
+// SINK, writes responses to sockets directly; server with default
+// send_callback_t sink gets it wrapped, send_file() and send_static()
+// included.
+template<std::size_t SEND_BUFFER_SIZE>
+class socket_sink
+{
+public:
+    explicit socket_sink(socket_output<SEND_BUFFER_SIZE>* out = nullptr) noexcept
+        : m_out ( out )
+    {}
+
+    void write(const char* const buf, std::size_t size)                 noexcept
+    {
+        m_out->write(buf, size);
+    }
+
+    bool send_file(int fd, std::size_t offset, std::size_t size)        noexcept
+    {
+        return m_out->send_file(fd, offset, size);
+    }
+
+    bool send_static(const char* const buf, std::size_t size)           noexcept
+    {
+        return m_out->send_static(buf, size);
+    }
+
+    void operator() (const char* const buf, std::size_t size)           noexcept
+    {
+        m_out->write(buf, size);
+    }
+
+    explicit operator bool()                                      const noexcept
+    {
+        return nullptr != m_out;
+    }
+
+private:
+    socket_output<SEND_BUFFER_SIZE>* m_out;
+};
+
+// Non-blocking driver of the server for Linux. Owns listen socket and
+// client sockets, one server connection per client socket.
+// Each connection has socket_output. Connection is not read until its
+// output is drained, and it is dropped, if output fails.
+// Received data is passed from one shared buffer, so connections must
+// copy it (default request_cache does).
+template
+<
+      typename    SERVER
+    , std::size_t RECV_BUFFER_SIZE = 2048
+    , std::size_t SEND_BUFFER_SIZE = 16384
+    , std::size_t EVENTS_COUNT     = 16
+>
+class event_loop
+{
+public:
+    using server_t      = SERVER;
+    using connection_t  = typename server_t::connection_t;
+    using socket_sink_t = socket_sink<SEND_BUFFER_SIZE>;
+
+    static_assert(std::is_constructible<typename server_t::sink_t, socket_sink_t>::value,
+                  "Server sink must be socket_sink of the same size or send_callback_t");
+    static_assert(!server_t::request_cache_t::borrows_buffer,
+                  "Receive buffer is shared by connections, request cache must copy data");
+
+    explicit event_loop(server_t& srv)                                  noexcept
+        : m_server ( srv )
+    {
+        for(auto& s : m_slots)
+        {
+            s.m_fd = -1;
+        }
+    }
+
+    ~event_loop()                                                       noexcept
+    {
+        close();
+    }
+
+    // Listens on all interfaces. Port "0" picks any free port.
+    // With reuse_port several loops may listen on the same port, kernel
+    // balances connections between them (SO_REUSEPORT).
+    // Loop, that was stopped, may be opened and run again.
+    bool open(const char* port, bool reuse_port = false)                noexcept
+    {
+        m_stop.store(false, std::memory_order_relaxed);
+
+        addrinfo  hints {};
+        addrinfo* info = nullptr;
+
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags    = AI_PASSIVE;
+
+        if(0 != getaddrinfo(nullptr, port, &hints, &info))
+        {
+            return false;
+        }
+
+        for(addrinfo* i = info; (nullptr != i) && (-1 == m_listen); i = i->ai_next)
+        {
+            m_listen = listen_on(i, reuse_port);
+        }
+
+        freeaddrinfo(info);
+
+        if(-1 == m_listen)
+        {
+            return false;
+        }
+
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+
+        epoll_event ev {};
+        ev.events   = EPOLLIN;
+        ev.data.ptr = nullptr;
+
+        if((-1 == m_epoll) || (0 != epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listen, &ev)))
+        {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close()                                                        noexcept
+    {
+        for(auto& s : m_slots)
+        {
+            release(s);
+        }
+
+        close_fd(m_epoll);
+        close_fd(m_listen);
+    }
+
+    // Port of the listen socket in host byte order, 0 if it isn't open.
+    unsigned short port()                                         const noexcept
+    {
+        sockaddr_storage addr {};
+        socklen_t        size = sizeof(addr);
+
+        if((-1 == m_listen) ||
+           (0 != getsockname(m_listen, reinterpret_cast<sockaddr*>(&addr), &size)))
+        {
+            return 0;
+        }
+
+        return ntohs((AF_INET6 == addr.ss_family)
+                     ? reinterpret_cast<sockaddr_in6*>(&addr)->sin6_port
+                     : reinterpret_cast<sockaddr_in*>(&addr)->sin_port);
+    }
+
+    // Handles events, that are ready or arrive within timeout_ms.
+    // Returns false on epoll error.
+    bool run_once(int timeout_ms)                                       noexcept
+    {
+        epoll_event events[EVENTS_COUNT];
+
+        int count = epoll_wait(m_epoll, events, EVENTS_COUNT, timeout_ms);
+        if(count < 0)
+        {
+            return EINTR == errno;
+        }
+
+        for(int i = 0; i < count; ++i)
+        {
+            if(nullptr == events[i].data.ptr)
+            {
+                accept_all();
+            }
+            else
+            {
+                handle(*static_cast<slot*>(events[i].data.ptr), events[i].events);
+            }
+        }
+
+        return true;
+    }
+
+    // Serves until epoll error or stop(), server time is advanced every
+    // tick_ms.
+    void run(int tick_ms)                                               noexcept
+    {
+        long next = monotonic_ms() + tick_ms;
+
+        while(!m_stop.load(std::memory_order_relaxed))
+        {
+            long left = next - monotonic_ms();
+
+            if(left <= 0)
+            {
+                tick();
+
+                next += tick_ms;
+                continue;
+            }
+
+            if(!run_once(static_cast<int>(left)))
+            {
+                return;
+            }
+        }
+    }
+
+    // May be called from other thread, run() returns within tick_ms.
+    void stop()                                                         noexcept
+    {
+        m_stop.store(true, std::memory_order_relaxed);
+    }
+
+    // Closes connections, that ran out of time.
+    void tick()                                                         noexcept
+    {
+        m_server.tick();
+
+        for(auto& s : m_slots)
+        {
+            if(-1 != s.m_fd)
+            {
+                update(s);
+            }
+        }
+    }
+
+private:
+    event_loop(const event_loop& other)                                = delete;
+    event_loop& operator= (const event_loop& other)                    = delete;
+    event_loop(const event_loop&& other)                               = delete;
+    event_loop& operator= (const event_loop&& other)                   = delete;
+
+    struct slot
+    {
+        int                             m_fd;
+        connection_t*                   m_connection;
+        socket_output<SEND_BUFFER_SIZE> m_out;
+    };
+
+    static void close_fd(int& fd)                                       noexcept
+    {
+        if(-1 != fd)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    static int listen_on(const addrinfo* i, bool reuse_port)            noexcept
+    {
+        int fd = socket(i->ai_family,
+                        i->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        i->ai_protocol);
+        if(-1 == fd)
+        {
+            return -1;
+        }
+
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+        if(reuse_port && (0 != setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes))))
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        if((0 != bind(fd, i->ai_addr, i->ai_addrlen)) || (0 != listen(fd, SOMAXCONN)))
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    void accept_all()                                                   noexcept
+    {
+        while(true)
+        {
+            int fd = accept4(m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if(-1 == fd)
+            {
+                return;
+            }
+
+            slot* s = find_free();
+            if((nullptr == s) || !attach(*s, fd))
+            {
+                ::close(fd);
+            }
+        }
+    }
+
+    slot* find_free()                                                   noexcept
+    {
+        for(auto& s : m_slots)
+        {
+            if(-1 == s.m_fd)
+            {
+                return &s;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool attach(slot& s, int fd)                                        noexcept
+    {
+        s.m_connection = m_server.open(typename server_t::sink_t(socket_sink_t(&s.m_out)));
+        if(nullptr == s.m_connection)
+        {
+            return false;
+        }
+
+        // Headers and data are sent separately, they shouldn't wait for ACK.
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        s.m_fd = fd;
+        s.m_out.open(fd, m_epoll, &s);
+
+        epoll_event ev {};
+        ev.events   = EPOLLIN;
+        ev.data.ptr = &s;
+
+        if(0 != epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev))
+        {
+            s.m_out.close();
+            m_server.close(s.m_connection);
+            s.m_connection = nullptr;
+            s.m_fd         = -1;
+            return false;
+        }
+
+        return true;
+    }
+
+    void release(slot& s)                                               noexcept
+    {
+        if(-1 == s.m_fd)
+        {
+            return;
+        }
+
+        m_server.close(s.m_connection);
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, s.m_fd, nullptr);
+        s.m_out.close();
+        close_fd(s.m_fd);
+
+        s.m_connection = nullptr;
+    }
+
+    void handle(slot& s, uint32_t events)                               noexcept
+    {
+        if(0 != (events & EPOLLOUT))
+        {
+            s.m_out.flush();
+        }
+
+        if((0 != (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) && !s.m_out.is_pending())
+        {
+            ssize_t size = recv(s.m_fd, m_buffer, sizeof(m_buffer), 0);
+
+            if((0 == size) || ((size < 0) && (EAGAIN != errno) && (EWOULDBLOCK != errno)))
+            {
+                release(s);
+                return;
+            }
+
+            if(size > 0)
+            {
+                s.m_connection->process_request(m_buffer, static_cast<std::size_t>(size));
+            }
+        }
+
+        update(s);
+    }
+
+    // Waits for output to drain before next request is read, closes
+    // connection, when it is done.
+    void update(slot& s)                                                noexcept
+    {
+        if(s.m_out.is_failed() || (!s.m_out.is_pending() && !s.m_connection->is_keep_alive()))
+        {
+            release(s);
+            return;
+        }
+
+        s.m_out.watch(s.m_out.is_pending() ? EPOLLOUT : EPOLLIN);
+    }
+
+    server_t&         m_server;
+    int               m_listen                           { -1 };
+    int               m_epoll                            { -1 };
+    slot              m_slots[server_t::connections_count] {};
+    char              m_buffer[RECV_BUFFER_SIZE]         {};
+    std::atomic<bool> m_stop                             { false };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_EVENT_LOOP_HPP
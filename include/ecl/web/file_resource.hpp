@@ -0,0 +1,508 @@
+#ifndef ECL_WEB_FILE_RESOURCE_HPP
+#define ECL_WEB_FILE_RESOURCE_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ecl/web/constants.hpp>
+#include <ecl/web/i_request_cache.hpp>
+#include <ecl/web/i_resource.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Files of root directory for Linux. Resource is attached with wildcard
+// pattern ("/files/*"), captured rest of the path is relative to root.
+// Descriptors and metadata of FILES_COUNT recently used files are cached,
+// file is checked again with stat(), when it is older than revalidate_ms,
+// so files may be replaced while server runs.
+// Gzip-compressed sibling ("name.gz") is sent to clients, that accept it.
+// Content is sent by sink (socket_sink sends it with sendfile), or read
+// with pread() in bounded parts and written to the stream. File isn't
+// mapped, so it may be truncated while it is sent.
+// Cache is locked only to find and revalidate the file, so resource may be
+// shared by shards. File is pinned while it is sent: its slot isn't reused,
+// and changed file is loaded to another slot. Request is answered with 503,
+// if all slots are pinned.
+template
+<
+      typename    ST
+    , std::size_t FILES_COUNT = 16
+    , std::size_t PATH_SIZE   = 256
+>
+class file_resource : public i_resource<ST>
+{
+public:
+    // Root is not copied and must outlive the resource.
+    explicit file_resource(const char* root, long revalidate_ms = 1000) noexcept
+        : m_root          ( root          )
+        , m_revalidate_ms ( revalidate_ms )
+    {}
+
+    virtual ~file_resource()                                   noexcept override
+    {
+        for(auto& f : m_files)
+        {
+            drop(f);
+        }
+    }
+
+    virtual status_code on_request(ST&              st,
+                                   i_request_cache& cache)     noexcept override
+    {
+        switch(cache.get_met())
+        {
+            case method::GET:
+            case method::HEAD:
+            break;
+            default:
+                return status_code::METHOD_NOT_ALLOWED;
+        }
+
+        char path[PATH_SIZE];
+
+        if(!make_path(cache.get_param("*"), path))
+        {
+            return status_code::NOT_FOUND;
+        }
+
+        status_code code = status_code::NOT_FOUND;
+        file*       f    = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            f = acquire(path, code);
+        }
+
+        if(nullptr == f)
+        {
+            return code;
+        }
+
+        // Smallest variant, that client accepts, same as static_resource.
+        header_value_t accepted = cache.get_hdr(header_name::ACCEPT_ENCODING);
+        std::size_t    size     = is_encoding_accepted(accepted, content_encoding::IDENTITY)
+                                ? f->m_identity.m_size : SIZE_MAX;
+
+        if((-1 != f->m_gzip.m_fd) && (f->m_gzip.m_size < size) &&
+           is_encoding_accepted(accepted, content_encoding::GZIP))
+        {
+            reply(st, cache, *f, f->m_gzip, content_encoding::GZIP);
+        }
+        else
+        {
+            reply(st, cache, *f, f->m_identity, content_encoding::IDENTITY);
+        }
+
+        release(*f);
+
+        return status_code::OK;
+    }
+
+private:
+    file_resource(const file_resource& other)                          = delete;
+    file_resource& operator= (const file_resource& other)              = delete;
+    file_resource(const file_resource&& other)                         = delete;
+    file_resource& operator= (const file_resource&& other)             = delete;
+
+    struct variant
+    {
+        int         m_fd       { -1 };
+        std::size_t m_size     { 0 };
+        ino_t       m_ino      { 0 };
+        timespec    m_mtime    {};
+        char        m_etag[48] {};
+    };
+
+    struct file
+    {
+        char         m_path[PATH_SIZE] {};
+        content_type m_type            { content_type::APPLICATION_OCTET_STREAM };
+        variant      m_identity        {};
+        variant      m_gzip            {};
+        long         m_checked         { 0 };
+        std::size_t  m_used            { 0 };
+        std::size_t  m_refs            { 0 };
+    };
+
+    // Root and decoded relative path. Path must leave room for ".gz" and
+    // must not leave root: ".." segments and escaped NUL are refused.
+    bool make_path(param_value_t rel, char (&path)[PATH_SIZE])    const noexcept
+    {
+        if((nullptr == rel) || (0 == *rel))
+        {
+            return false;
+        }
+
+        std::size_t length = std::strlen(m_root);
+        if(length + 2 > PATH_SIZE)
+        {
+            return false;
+        }
+
+        std::memcpy(path, m_root, length);
+        path[length++] = '/';
+
+        char* const begin   = path + length;
+        char*       out     = begin;
+        char* const end     = path + PATH_SIZE - sizeof(".gz");
+        const char* rel_end = rel + std::strlen(rel);
+
+        for(const char* p = rel; 0 != *p; ++p, ++out)
+        {
+            if(out == end)
+            {
+                return false;
+            }
+
+            *out = *p;
+
+            if('%' == *p)
+            {
+                int c = percent_decode(p, rel_end);
+                if(c < 0)
+                {
+                    return false;
+                }
+
+                *out = static_cast<char>(c);
+                p += 2;
+            }
+        }
+
+        *out = 0;
+
+        for(const char* s = begin; nullptr != s; s = std::strchr(s, '/'))
+        {
+            s += ('/' == *s) ? 1 : 0;
+
+            if((0 == std::strncmp(s, "..", 2)) && (('/' == s[2]) || (0 == s[2])))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Cached file or file, that is loaded in place of least recently used
+    // one, that isn't pinned. Returned file is pinned until release().
+    file* acquire(const char* path, status_code& code)                  noexcept
+    {
+        long  now = monotonic_ms();
+        file* lru = nullptr;
+
+        for(auto& f : m_files)
+        {
+            if(0 == std::strcmp(f.m_path, path))
+            {
+                const bool fresh = (now - f.m_checked < m_revalidate_ms);
+
+                if(fresh || is_same(f))
+                {
+                    f.m_checked = fresh ? f.m_checked : now;
+                    f.m_used    = ++m_used;
+                    ++f.m_refs;
+
+                    return &f;
+                }
+
+                retire(f);
+            }
+
+            if((0 == f.m_refs) && ((nullptr == lru) || (f.m_used < lru->m_used)))
+            {
+                lru = &f;
+            }
+        }
+
+        if(nullptr == lru)
+        {
+            code = status_code::SERVICE_UNAVAILABLE;
+            return nullptr;
+        }
+
+        file* f = load(*lru, path, now);
+        if(nullptr != f)
+        {
+            ++f->m_refs;
+        }
+
+        return f;
+    }
+
+    void release(file& f)                                               noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if((0 == --f.m_refs) && (0 == f.m_path[0]))
+        {
+            drop(f);
+        }
+    }
+
+    // Changed file isn't found any more. Descriptors of pinned file are
+    // closed by the last release().
+    static void retire(file& f)                                         noexcept
+    {
+        f.m_path[0] = 0;
+
+        if(0 == f.m_refs)
+        {
+            drop(f);
+        }
+    }
+
+    // Slot keeps cached file, if there is no such file.
+    file* load(file& f, const char* path, long now)                     noexcept
+    {
+        variant identity {};
+        if(!open_variant(path, "", identity))
+        {
+            return nullptr;
+        }
+
+        drop(f);
+
+        std::strcpy(f.m_path, path);
+        f.m_type     = to_content_type(path);
+        f.m_identity = identity;
+        f.m_checked  = now;
+        f.m_used     = ++m_used;
+
+        open_variant(path, ".gz", f.m_gzip);
+
+        return &f;
+    }
+
+    // Path always leaves room for suffix, see make_path().
+    static void add_suffix(char (&name)[PATH_SIZE],
+                           const char* path,
+                           const char* suffix)                          noexcept
+    {
+        std::size_t length = std::strlen(path);
+
+        std::memcpy(name, path, length);
+        std::strcpy(name + length, suffix);
+    }
+
+    static bool open_variant(const char* path,
+                             const char* suffix,
+                             variant&    v)                             noexcept
+    {
+        char name[PATH_SIZE];
+        add_suffix(name, path, suffix);
+
+        int fd = open(name, O_RDONLY | O_CLOEXEC);
+        if(-1 == fd)
+        {
+            return false;
+        }
+
+        struct stat s {};
+        if((0 != fstat(fd, &s)) || !S_ISREG(s.st_mode))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        v.m_fd    = fd;
+        v.m_size  = static_cast<std::size_t>(s.st_size);
+        v.m_ino   = s.st_ino;
+        v.m_mtime = s.st_mtim;
+
+        std::snprintf(v.m_etag, sizeof(v.m_etag), "\"%zx-%lx.%lx%s\"",
+                      v.m_size,
+                      static_cast<unsigned long>(s.st_mtim.tv_sec),
+                      static_cast<unsigned long>(s.st_mtim.tv_nsec),
+                      suffix);
+
+        return true;
+    }
+
+    bool is_same(const file& f)                                   const noexcept
+    {
+        char gzip[PATH_SIZE];
+        add_suffix(gzip, f.m_path, ".gz");
+
+        return is_same(f.m_identity, f.m_path) && is_same(f.m_gzip, gzip);
+    }
+
+    // Replaced file has another inode, rewritten one has another mtime.
+    static bool is_same(const variant& v, const char* path)             noexcept
+    {
+        struct stat s {};
+        if(0 != stat(path, &s))
+        {
+            return -1 == v.m_fd;
+        }
+
+        return (-1 != v.m_fd)                                     &&
+               (v.m_ino                == s.st_ino)               &&
+               (v.m_size               == static_cast<std::size_t>(s.st_size)) &&
+               (v.m_mtime.tv_sec       == s.st_mtim.tv_sec)       &&
+               (v.m_mtime.tv_nsec      == s.st_mtim.tv_nsec);
+    }
+
+    static void close_variant(variant& v)                               noexcept
+    {
+        if(-1 != v.m_fd)
+        {
+            ::close(v.m_fd);
+        }
+
+        v = variant();
+    }
+
+    static void drop(file& f)                                           noexcept
+    {
+        close_variant(f.m_identity);
+        close_variant(f.m_gzip);
+
+        f.m_path[0] = 0;
+    }
+
+    // Stops at the end of file, if it was truncated after stat().
+    static void read_to(ST& st, const variant& v, range_t r)            noexcept
+    {
+        char buf[READ_SIZE];
+
+        while(0 != r.second)
+        {
+            std::size_t size = (r.second < sizeof(buf)) ? r.second : sizeof(buf);
+            ssize_t     got  = pread(v.m_fd, buf, size, static_cast<off_t>(r.first));
+
+            if(got < 0)
+            {
+                if(EINTR == errno)
+                {
+                    continue;
+                }
+
+                return;
+            }
+
+            if(0 == got)
+            {
+                return;
+            }
+
+            st.write(buf, static_cast<std::size_t>(got));
+
+            r.first  += static_cast<std::size_t>(got);
+            r.second -= static_cast<std::size_t>(got);
+        }
+    }
+
+    static void write_cache_headers(ST& st, const file& f)              noexcept
+    {
+        if(-1 != f.m_gzip.m_fd)
+        {
+            st << "Vary:Accept-Encoding\r\n";
+        }
+
+        st << "Cache-Control:no-cache\r\n";
+    }
+
+    static void reply(ST&              st,
+                      i_request_cache& cache,
+                      const file&      f,
+                      variant&         v,
+                      content_encoding e)                               noexcept
+    {
+        // Validator and cache headers are the same as in 200.
+        if(is_not_modified(cache.get_hdr(header_name::IF_NONE_MATCH), v.m_etag))
+        {
+            write_status_line(st, cache.get_ver(), status_code::NOT_MODIFIED);
+            set_connection_header(st, cache.get_keep_alive());
+            set_etag_header(st, v.m_etag);
+            write_cache_headers(st, f);
+            st << "\r\n";
+
+            st.flush();
+
+            return;
+        }
+
+        status_code code = status_code::OK;
+        range_t     r    { 0, v.m_size };
+
+        if((method::GET == cache.get_met()) &&
+           is_range_valid(cache.get_hdr(header_name::IF_RANGE), v.m_etag))
+        {
+            switch(cache.get_range(v.m_size, r))
+            {
+                case range_status::NONE:
+                    r = range_t { 0, v.m_size };
+                break;
+                case range_status::SATISFIABLE:
+                    code = status_code::PARTIAL_CONTENT;
+                break;
+                case range_status::NOT_SATISFIABLE:
+                    write_range_not_satisfiable(st, cache.get_ver(), cache.get_keep_alive(), v.m_size);
+                return;
+            }
+        }
+
+        write_status_line(st, cache.get_ver(), code);
+        set_connection_header(st, cache.get_keep_alive());
+        set_content_type_header(st, f.m_type);
+
+        if(content_encoding::IDENTITY != e)
+        {
+            set_content_encoding_header(st, e);
+        }
+
+        if(status_code::PARTIAL_CONTENT == code)
+        {
+            set_content_range_header(st, r, v.m_size);
+        }
+
+        set_content_length_header(st, r.second);
+        set_etag_header(st, v.m_etag);
+        write_cache_headers(st, f);
+
+        st << "Accept-Ranges:bytes\r\n"
+           << "\r\n";
+
+        if((method::HEAD == cache.get_met()) || (0 == r.second) ||
+           st.send_file(v.m_fd, r.first, r.second))
+        {
+            st.flush();
+            return;
+        }
+
+        // Headers are sent already, connection is broken, if file can't
+        // be read, as promised length is not sent.
+        read_to(st, v, r);
+
+        st.flush();
+    }
+
+    // Part of file, that is read to the stack at once.
+    static constexpr std::size_t READ_SIZE = 4096;
+
+    const char* m_root;
+    long        m_revalidate_ms;
+    file        m_files[FILES_COUNT] {};
+    std::size_t m_used               { 0 };
+    std::mutex  m_mutex              {};
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_FILE_RESOURCE_HPP
@@ -3,6 +3,7 @@
 
 #include <ecl/web/types.hpp>
 #include <ecl/web/constants.hpp>
+#include <ecl/web/url_params.hpp>
 
 #include <utility>
 
@@ -24,13 +25,22 @@ struct i_request_cache
     virtual url_field_t    get_url ( url_field )                   noexcept = 0;
     virtual method         get_met ()                              noexcept = 0;
     virtual header_value_t get_hdr ( header_name_t )               noexcept = 0;
+    virtual header_value_t get_hdr ( header_name )                 noexcept = 0;
     virtual body_t         get_body()                              noexcept = 0;
+    virtual bool           get_keep_alive()                        noexcept = 0;
+    virtual param_value_t  get_param( param_name_t )               noexcept = 0;
+    virtual range_status   get_range( std::size_t, range_t& )      noexcept = 0;
+    virtual const url_params& get_query()                          noexcept = 0;
+    virtual const url_params& get_form()                           noexcept = 0;
 
     virtual void           set_ver ( version  )                    noexcept = 0;
     virtual void           set_url ( url_t    )                    noexcept = 0;
     virtual void           set_met ( method   )                    noexcept = 0;
     virtual void           set_hdr ( header_t )                    noexcept = 0;
+    virtual void           set_hdr ( header_name, header_t )       noexcept = 0;
     virtual void           set_body( body_t   )                    noexcept = 0;
+    virtual void           set_keep_alive( bool )                  noexcept = 0;
+    virtual bool           set_param( fragment_t, fragment_t )     noexcept = 0;
 };
 
 } // namespace web
@@ -1,6 +1,8 @@
 #ifndef ECL_WEB_I_RESOURCE_HPP
 #define ECL_WEB_I_RESOURCE_HPP
 
+#include <cstddef>
+
 #include <ecl/web/types.hpp>
 #include <ecl/web/constants.hpp>
 #include <ecl/web/i_request_cache.hpp>
@@ -11,6 +13,21 @@ namespace ecl
 namespace web
 {
 
+// Long-lived connection (WebSocket, event stream), that resource takes
+// over after its response. Connection data is passed to the session
+// instead of HTTP parser, stream may be written at any time until
+// on_close().
+template<typename ST>
+struct i_session
+{
+    virtual      ~i_session()                                           noexcept
+    {}
+
+    // Returns false to close the connection.
+    virtual bool on_data(ST&, const char*, std::size_t)            noexcept = 0;
+    virtual void on_close(ST&)                                     noexcept = 0;
+};
+
 template<typename ST>
 struct i_resource
 {
@@ -20,6 +37,29 @@ struct i_resource
     {}
 
     virtual status_code  on_request(ST&, i_request_cache&)         noexcept = 0;
+
+    // Optional body streaming. If on_body_begin() returns true, body is
+    // passed to on_body_chunk() as it arrives instead of being cached, and
+    // on_request() is called after the last chunk with empty body.
+    // Error code returned from on_body_chunk() drops the request.
+    virtual bool         on_body_begin(i_request_cache&)                noexcept
+    {
+        return false;
+    }
+
+    virtual status_code  on_body_chunk(i_request_cache&,
+                                       const char*,
+                                       std::size_t)                     noexcept
+    {
+        return status_code::OK;
+    }
+
+    // Optional session. Called after on_request(), if connection is kept
+    // alive. Returned session takes the connection over.
+    virtual i_session<ST>* open_session(ST&, i_request_cache&)          noexcept
+    {
+        return nullptr;
+    }
 };
 
 template<typename ST>
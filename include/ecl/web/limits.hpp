@@ -0,0 +1,29 @@
+#ifndef ECL_WEB_LIMITS_HPP
+#define ECL_WEB_LIMITS_HPP
+
+#include <cstddef>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Limits are checked while request is parsed, so request is answered with
+// error as soon as it exceeds one of them. Zero means no limit.
+// Time is counted in calls of tick(), period of ticks is up to the caller.
+struct request_limits
+{
+    std::size_t headers_count; // 431
+    std::size_t headers_size;  // 431, URL, names and values bytes
+    std::size_t url_length;    // 414
+    std::size_t body_size;     // 413
+    std::size_t request_ticks; // 408, time to receive whole request
+    std::size_t idle_ticks;    // keep-alive connection without request is closed
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_LIMITS_HPP
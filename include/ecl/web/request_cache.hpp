@@ -2,6 +2,8 @@
 #define ECL_WEB_REQUEST_CACHE_HPP
 
 #include <algorithm>
+#include <array>
+#include <cstring>
 
 #include "http_parser.h"
 
@@ -9,53 +11,44 @@
 #include <ecl/web/constants.hpp>
 #include <ecl/web/i_request_cache.hpp>
 
-#include <ecl/map.hpp>
-
 namespace ecl
 {
 
 namespace web
 {
 
+// Parsed request fields. Storage of the raw request is up to derived class.
+// Route parameters are copied to own buffer, as they are not delimited
+// in the request.
+// Known headers are stored in array indexed by header name, up to
+// HEADERS_COUNT other headers are kept in arrival order. Other headers are
+// dropped, so with zero HEADERS_COUNT only known headers are stored.
 template
 <
-      std::size_t CACHE_SIZE    = 1536
-    , std::size_t HEADERS_COUNT = 32
+      std::size_t HEADERS_COUNT
+    , std::size_t PARAMS_COUNT       = 4
+    , std::size_t PARAMS_BUFFER_SIZE = 128
 >
-struct request_cache : public i_request_cache
+struct request_cache_base : public i_request_cache
 {
-private:
-    using header_map_t = ecl::map<header_name_t, header_value_t, HEADERS_COUNT>;
-
-public:
-    using url_schema_map_t = ecl::map
-                             <
-                                   url_field
-                                 , url_field_t
-                                 , UF_MAX
-                             >;
-
-    ~request_cache()                                                    noexcept
+    ~request_cache_base()                                               noexcept
     {
     }
 
-    virtual std::size_t cache(const char* buf,
-                              std::size_t length)              noexcept override
-    {
-        m_rq_raw_size = std::min(length, CACHE_SIZE);
-        memcpy(m_rq_raw, buf, m_rq_raw_size);
-
-        return m_rq_raw_size;
-    }
-
     virtual void clear()                                       noexcept override
     {
         m_ver = version::HTTP11;
         m_url = "/";
         m_met = method::GET;
-        m_headers.clear();
+        std::fill(std::begin(m_known_headers), std::end(m_known_headers), nullptr);
+        m_headers_count = 0;
         m_body = { nullptr, 0 };
-        m_url_fields.clear();
+        m_keep_alive = true;
+        m_url_parsed = false;
+        m_query_parsed = false;
+        m_form_parsed = false;
+        m_params_count = 0;
+        m_params_buffer_size = 0;
     }
 
     virtual version get_ver()                                  noexcept override
@@ -68,9 +61,20 @@ public:
         return m_url;
     }
 
+    // URL is split to fields on the first call only.
     virtual url_field_t get_url(url_field f)                   noexcept override
     {
-        return m_url_fields[f];
+        if(url_field::UNKNOWN == f)
+        {
+            return nullptr;
+        }
+
+        if(!m_url_parsed)
+        {
+            parse_url();
+        }
+
+        return m_url_fields[static_cast<std::size_t>(f)];
     }
 
     virtual method get_met()                                   noexcept override
@@ -78,9 +82,33 @@ public:
         return m_met;
     }
 
-    virtual header_value_t get_hdr(header_name_t num)          noexcept override
+    virtual header_value_t get_hdr(header_name_t name)         noexcept override
     {
-        return m_headers[num];
+        header_name n = to_header_name(name, std::strlen(name));
+        if(header_name::UNKNOWN != n)
+        {
+            return get_hdr(n);
+        }
+
+        for(std::size_t i = 0; i < m_headers_count; ++i)
+        {
+            if(0 == header_name_cmp(m_headers[i].first, name))
+            {
+                return m_headers[i].second;
+            }
+        }
+
+        return nullptr;
+    }
+
+    virtual header_value_t get_hdr(header_name n)              noexcept override
+    {
+        if(header_name::UNKNOWN == n)
+        {
+            return nullptr;
+        }
+
+        return m_known_headers[static_cast<std::size_t>(n)];
     }
 
     virtual body_t get_body()                                  noexcept override
@@ -88,6 +116,131 @@ public:
         return m_body;
     }
 
+    virtual bool get_keep_alive()                              noexcept override
+    {
+        return m_keep_alive;
+    }
+
+    virtual param_value_t get_param(param_name_t name)         noexcept override
+    {
+        std::size_t length = std::strlen(name);
+
+        for(std::size_t i = 0; i < m_params_count; ++i)
+        {
+            if((m_params[i].first.second == length) &&
+               (0 == std::strncmp(m_params[i].first.first, name, length)))
+            {
+                return m_params[i].second;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Query string is decoded in place on the first call.
+    virtual const url_params& get_query()                      noexcept override
+    {
+        if(!m_query_parsed)
+        {
+            char* q = const_cast<char*>(get_url(url_field::QUERY));
+
+            m_query.parse(q, (nullptr == q) ? 0 : std::strlen(q));
+            m_query_parsed = true;
+        }
+
+        return m_query;
+    }
+
+    // Body is decoded in place on the first call, if it is
+    // application/x-www-form-urlencoded. Raw body is not valid after that.
+    virtual const url_params& get_form()                       noexcept override
+    {
+        if(!m_form_parsed)
+        {
+            static const char form_type[] = "application/x-www-form-urlencoded";
+
+            header_value_t type = get_hdr(header_name::CONTENT_TYPE);
+
+            if((nullptr != type) &&
+               (0 == std::strncmp(type, form_type, sizeof(form_type) - 1)))
+            {
+                m_form.parse(const_cast<char*>(m_body.first), m_body.second);
+            }
+            else
+            {
+                m_form.parse(nullptr, 0);
+            }
+
+            m_form_parsed = true;
+        }
+
+        return m_form;
+    }
+
+    // Single byte range of entity of given size. Multiple ranges and
+    // malformed values are ignored, so entity is sent whole.
+    virtual range_status get_range(std::size_t size, range_t& r) noexcept override
+    {
+        header_value_t v = get_hdr(header_name::RANGE);
+
+        if((nullptr == v) || (0 != std::strncmp(v, "bytes=", 6)) ||
+           (nullptr != std::strchr(v, ',')))
+        {
+            return range_status::NONE;
+        }
+
+        v += 6;
+
+        std::size_t first = 0;
+        std::size_t last  = 0;
+
+        if('-' == *v)
+        {
+            ++v;
+
+            if(!parse_size(v, last) || (0 != *v))
+            {
+                return range_status::NONE;
+            }
+
+            if(0 == last)
+            {
+                return range_status::NOT_SATISFIABLE;
+            }
+
+            first = (size > last) ? size - last : 0;
+            last  = size - 1;
+        }
+        else
+        {
+            if(!parse_size(v, first) || ('-' != *v))
+            {
+                return range_status::NONE;
+            }
+
+            ++v;
+
+            if(0 == *v)
+            {
+                last = size - 1;
+            }
+            else if(!parse_size(v, last) || (0 != *v) || (last < first))
+            {
+                return range_status::NONE;
+            }
+        }
+
+        if(first >= size)
+        {
+            return range_status::NOT_SATISFIABLE;
+        }
+
+        last = std::min(last, size - 1);
+        r = std::make_pair(first, last - first + 1);
+
+        return range_status::SATISFIABLE;
+    }
+
     virtual void set_ver(version v)                            noexcept override
     {
         m_ver = v;
@@ -95,38 +248,164 @@ public:
 
     virtual void set_url(url_t u)                              noexcept override
     {
-        m_url = u;
+        m_url        = u;
+        m_url_parsed = false;
+    }
 
-        m_url_fields.clear();
+    virtual void set_met(method m)                             noexcept override
+    {
+        m_met = m;
+    }
+
+    virtual void set_hdr(header_t h)                           noexcept override
+    {
+        set_hdr(to_header_name(h.first, std::strlen(h.first)), h);
+    }
+
+    // Name of the header is already recognised by caller.
+    virtual void set_hdr(header_name n, header_t h)            noexcept override
+    {
+        if(header_name::UNKNOWN != n)
+        {
+            m_known_headers[static_cast<std::size_t>(n)] = h.second;
+        }
+        else if(m_headers_count < m_headers.size())
+        {
+            m_headers[m_headers_count++] = h;
+        }
+    }
+
+    virtual void set_body(body_t b)                            noexcept override
+    {
+        m_body = b;
+    }
+
+    virtual void set_keep_alive(bool k)                        noexcept override
+    {
+        m_keep_alive = k;
+    }
+
+    virtual bool set_param(fragment_t name, fragment_t value)  noexcept override
+    {
+        if((m_params_count >= PARAMS_COUNT) ||
+           (value.second + 1 > PARAMS_BUFFER_SIZE - m_params_buffer_size))
+        {
+            return false;
+        }
+
+        char* p = m_params_buffer + m_params_buffer_size;
+        memcpy(p, value.first, value.second);
+        p[value.second] = 0;
+
+        m_params_buffer_size += value.second + 1;
+
+        m_params[m_params_count++] = std::make_pair(name, p);
+
+        return true;
+    }
+
+private:
+    // Fields are terminated in place, so whole URL is cut at the first
+    // field end after that.
+    void parse_url()                                                    noexcept
+    {
+        std::fill(std::begin(m_url_fields), std::end(m_url_fields), nullptr);
+        m_url_parsed = true;
 
         http_parser_url parser_url;
         http_parser_url_init(&parser_url);
-        http_parser_parse_url(u, std::strlen(m_url), 0, &parser_url);
+
+        if(0 != http_parser_parse_url(m_url, std::strlen(m_url), 0, &parser_url))
+        {
+            return;
+        }
 
         for(int f = UF_SCHEMA; f < UF_MAX; ++f)
         {
             if(parser_url.field_set & (1 << f))
             {
-                const char* p = m_url + parser_url.field_data[f].off;
-                m_url_fields[to_url_field(f)] = p;
-                const_cast<char*>(p)[parser_url.field_data[f].len] = 0;
+                char* p = const_cast<char*>(m_url) + parser_url.field_data[f].off;
+
+                m_url_fields[static_cast<std::size_t>(to_url_field(f))] = p;
+
+                // Default URL is a literal, it is terminated already.
+                if(0 != p[parser_url.field_data[f].len])
+                {
+                    p[parser_url.field_data[f].len] = 0;
+                }
             }
         }
     }
 
-    virtual void set_met(method m)                             noexcept override
+    static bool parse_size(const char*& p, std::size_t& out)            noexcept
     {
-        m_met = m;
+        const char* begin = p;
+        out = 0;
+
+        for(; (*p >= '0') && (*p <= '9'); ++p)
+        {
+            std::size_t digit = static_cast<std::size_t>(*p - '0');
+
+            if(out > (std::size_t(-1) - digit) / 10)
+            {
+                return false;
+            }
+
+            out = out * 10 + digit;
+        }
+
+        return p != begin;
     }
 
-    virtual void set_hdr(header_t h)                           noexcept override
+    version          m_ver                { version::HTTP11 };
+    url_t            m_url                { "/" };
+    method           m_met                { method::GET };
+    header_value_t   m_known_headers[static_cast<std::size_t>(header_name::UNKNOWN)] {};
+    std::array<header_t, HEADERS_COUNT> m_headers {};
+    std::size_t      m_headers_count      { 0 };
+    body_t           m_body               {};
+    bool             m_keep_alive         { true };
+
+    url_field_t      m_url_fields[static_cast<std::size_t>(url_field::UNKNOWN)] {};
+    bool             m_url_parsed         { false };
+
+    url_params       m_query              {};
+    bool             m_query_parsed       { false };
+    url_params       m_form               {};
+    bool             m_form_parsed        { false };
+
+    std::pair<fragment_t, param_value_t> m_params[PARAMS_COUNT] {};
+    std::size_t      m_params_count       { 0 };
+    char             m_params_buffer[PARAMS_BUFFER_SIZE] {};
+    std::size_t      m_params_buffer_size { 0 };
+};
+
+template
+<
+      std::size_t CACHE_SIZE    = 1536
+    , std::size_t HEADERS_COUNT = 32
+>
+struct request_cache : public request_cache_base<HEADERS_COUNT>
+{
+    // Request is copied, caller may reuse its buffer at once.
+    static constexpr bool borrows_buffer = false;
+
+    ~request_cache()                                                    noexcept
     {
-        m_headers.insert(h);
     }
 
-    virtual void set_body(body_t b)                            noexcept override
+    // Appends fragment to the already cached data.
+    // Returns count of bytes, that fit into the cache.
+    virtual std::size_t cache(const char* buf,
+                              std::size_t length)              noexcept override
     {
-        m_body = b;
+        std::size_t size = std::min(length, CACHE_SIZE - m_rq_raw_size);
+        memcpy(m_rq_raw + m_rq_raw_size, buf, size);
+
+        m_rq_raw_size += size;
+        m_rq_raw[m_rq_raw_size] = 0;
+
+        return size;
     }
 
     char* get_raw_rq()                                                  noexcept
@@ -139,17 +418,119 @@ public:
         return m_rq_raw_size;
     }
 
+    // Drops first n bytes of raw request, moving the rest to the beginning.
+    void shift(std::size_t n)                                           noexcept
+    {
+        n = std::min(n, m_rq_raw_size);
+
+        memmove(m_rq_raw, m_rq_raw + n, m_rq_raw_size - n);
+
+        m_rq_raw_size -= n;
+        m_rq_raw[m_rq_raw_size] = 0;
+    }
+
+    // Drops n bytes at pos, data after them is moved down.
+    bool erase(std::size_t pos, std::size_t n)                          noexcept
+    {
+        if(pos > m_rq_raw_size)
+        {
+            return false;
+        }
+
+        n = std::min(n, m_rq_raw_size - pos);
+
+        memmove(m_rq_raw + pos, m_rq_raw + pos + n, m_rq_raw_size - pos - n);
+
+        m_rq_raw_size -= n;
+        m_rq_raw[m_rq_raw_size] = 0;
+
+        return true;
+    }
+
 private:
-    char             m_rq_raw[CACHE_SIZE] {};
-    std::size_t      m_rq_raw_size        { 0 };
+    char        m_rq_raw[CACHE_SIZE + 1] {};
+    std::size_t m_rq_raw_size            { 0 };
+};
 
-    version          m_ver                { version::HTTP11 };
-    url_t            m_url                { "/" };
-    method           m_met                { method::GET };
-    header_map_t     m_headers            {};
-    body_t           m_body               {};
+// Request cache, that doesn't copy request. It borrows caller's receive
+// buffer, which must be writable, stay untouched until request is processed
+// and have one spare byte after received data.
+// Data, that is left borrowed after processing (incomplete request, even
+// if it follows pipelined ones), is reported by connection::get_pending().
+// Next fragment must be received right after it, fragment elsewhere is
+// refused as too large request. Buffer may be reused from its beginning,
+// when nothing is pending. So the cache doesn't suit drivers, that receive
+// all connections into one shared buffer (event_loop).
+// CACHE_SIZE is maximum request size.
+template
+<
+      std::size_t CACHE_SIZE    = 1536
+    , std::size_t HEADERS_COUNT = 32
+>
+struct zero_copy_request_cache : public request_cache_base<HEADERS_COUNT>
+{
+    static constexpr bool borrows_buffer = true;
+
+    zero_copy_request_cache()                                           noexcept
+    {
+    }
+
+    ~zero_copy_request_cache()                                          noexcept
+    {
+    }
+
+    // Borrows fragment. Fragment continues borrowed data or starts new one,
+    // if there is no pending data. Returns count of borrowed bytes.
+    virtual std::size_t cache(const char* buf,
+                              std::size_t length)              noexcept override
+    {
+        if(0 == m_rq_raw_size)
+        {
+            m_rq_raw = const_cast<char*>(buf);
+        }
+        else if(m_rq_raw + m_rq_raw_size != buf)
+        {
+            return 0;
+        }
+
+        std::size_t size = std::min(length, CACHE_SIZE - m_rq_raw_size);
+        m_rq_raw_size += size;
+
+        return size;
+    }
+
+    char* get_raw_rq()                                                  noexcept
+    {
+        return m_rq_raw;
+    }
+
+    std::size_t get_raw_rq_size()                                       noexcept
+    {
+        return m_rq_raw_size;
+    }
+
+    // Drops first n bytes of borrowed request.
+    void shift(std::size_t n)                                           noexcept
+    {
+        n = std::min(n, m_rq_raw_size);
+
+        m_rq_raw      += n;
+        m_rq_raw_size -= n;
+    }
+
+    // Borrowed buffer belongs to the caller, nothing can be dropped from
+    // the middle of it.
+    bool erase(std::size_t, std::size_t)                                noexcept
+    {
+        return false;
+    }
+
+private:
+    zero_copy_request_cache(const zero_copy_request_cache&)            = delete;
+    zero_copy_request_cache& operator= (const zero_copy_request_cache&) = delete;
 
-    url_schema_map_t m_url_fields         {};
+    char*       m_rq_raw      { nullptr };
+    std::size_t m_rq_raw_size { 0 };
 };
 
 } // namespace web
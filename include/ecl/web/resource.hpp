@@ -2,6 +2,8 @@
 #define ECL_WEB_RESOURCE_HPP
 
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include <ecl/web/i_request_cache.hpp>
 #include <ecl/web/i_resource.hpp>
@@ -14,52 +16,212 @@ namespace ecl
 namespace web
 {
 
+// Compressed variants of the resource are optional nested types of T,
+// generated by res_gen.sh with the same members as T.
+template<typename T>
+struct void_type
+{
+    using type = void;
+};
+
+template<typename T, typename = void>
+struct gzip_variant : std::false_type
+{
+    using type = T;
+};
+
+template<typename T>
+struct gzip_variant<T, typename void_type<typename T::gzip>::type> : std::true_type
+{
+    using type = typename T::gzip;
+};
+
+template<typename T, typename = void>
+struct br_variant : std::false_type
+{
+    using type = T;
+};
+
+template<typename T>
+struct br_variant<T, typename void_type<typename T::br>::type> : std::true_type
+{
+    using type = typename T::br;
+};
+
 template<typename T, typename ST>
 struct static_resource : public i_static_resource<ST>
 {
     virtual ~static_resource()                                 noexcept override
     {}
 
-    static_resource(content_type t, status_code c = status_code::OK)
-        : m_type ( t )
+    // Content type is the one, that res_gen.sh has rendered to T.
+    explicit static_resource(status_code c = status_code::OK)
+        : m_type ( mime_to_content_type(T::mime_type) )
         , m_code ( c )
     {}
 
+    // Former constructor. Content type argument is ignored, the rendered
+    // one is sent.
+    [[gnu::deprecated("content type is taken from res_gen.sh output")]]
+    explicit static_resource(content_type, status_code c = status_code::OK)
+        : static_resource(c)
+    {}
+
+    // Smallest variant, that client accepts, is sent.
     virtual status_code on_request(ST&              st,
                                    i_request_cache& cache)     noexcept override
     {
-        if(method::GET != cache.get_met())
+        switch(select_encoding(cache))
         {
-            return status_code::METHOD_NOT_ALLOWED;
+            case content_encoding::BR:
+                return reply<typename br_variant<T>::type>(st, cache);
+            case content_encoding::GZIP:
+                return reply<typename gzip_variant<T>::type>(st, cache);
+            case content_encoding::IDENTITY:
+            break;
         }
 
-        write_status_line(st, cache.get_ver(), m_code);
+        return reply<T>(st, cache);
+    }
 
-        set_content_type_header(st, m_type);
+    virtual content_type get_content_type()                    noexcept override
+    {
+        return m_type;
+    }
 
-        if(T::compressed)
+    virtual status_code get_status_code()                      noexcept override
+    {
+        return m_code;
+    }
+
+private:
+    static content_encoding select_encoding(i_request_cache& cache)     noexcept
+    {
+        header_value_t accepted = cache.get_hdr(header_name::ACCEPT_ENCODING);
+
+        content_encoding e    = content_encoding::IDENTITY;
+        std::size_t      size = T::size;
+
+        // Identity is sent, if nothing is acceptable.
+        if(!is_encoding_accepted(accepted, e))
         {
-            set_content_encoding_header(st, content_encoding::GZIP);
+            size = SIZE_MAX;
         }
 
-        st << "\r\n" << T::data << "\r\n";
+        if(br_variant<T>::value                              &&
+           (br_variant<T>::type::size < size)                &&
+           is_encoding_accepted(accepted, content_encoding::BR))
+        {
+            e    = content_encoding::BR;
+            size = br_variant<T>::type::size;
+        }
 
-        st.flush();
+        if(gzip_variant<T>::value                            &&
+           (gzip_variant<T>::type::size < size)              &&
+           is_encoding_accepted(accepted, content_encoding::GZIP))
+        {
+            e    = content_encoding::GZIP;
+            size = gzip_variant<T>::type::size;
+        }
 
-        return status_code::OK;
+        return e;
     }
 
-    virtual content_type get_content_type()                    noexcept override
+    // V is generated by res_gen.sh: entity headers are already rendered
+    // in front of data, so only status line and Connection header
+    // are written to the stream.
+    template<typename V>
+    status_code reply(ST&              st,
+                      i_request_cache& cache)                           noexcept
     {
-        return m_type;
+        std::size_t size = V::response_size;
+
+        switch(cache.get_met())
+        {
+            case method::GET:
+            break;
+            case method::HEAD:
+                size = V::headers_size;
+            break;
+            default:
+                return status_code::METHOD_NOT_ALLOWED;
+        }
+
+        // Validator and cache headers (ETag, Vary, Cache-Control) close
+        // the rendered headers, 304 repeats them as they are in 200.
+        if((status_code::OK == m_code) &&
+           is_not_modified(cache.get_hdr(header_name::IF_NONE_MATCH), V::etag))
+        {
+            write_status_line(st, cache.get_ver(), status_code::NOT_MODIFIED);
+            set_connection_header(st, cache.get_keep_alive());
+            st.write(reinterpret_cast<const char*>(V::response) + V::validators_offset,
+                     V::headers_size - V::validators_offset);
+
+            st.flush();
+
+            return status_code::OK;
+        }
+
+        if((status_code::OK == m_code) && (method::GET == cache.get_met()))
+        {
+            range_t r {};
+
+            switch(is_range_valid(cache.get_hdr(header_name::IF_RANGE), V::etag)
+                   ? cache.get_range(V::size, r) : range_status::NONE)
+            {
+                case range_status::NONE:
+                break;
+                case range_status::SATISFIABLE:
+                    write_range<V>(st, cache, r);
+                return status_code::OK;
+                case range_status::NOT_SATISFIABLE:
+                    write_range_not_satisfiable(st, cache.get_ver(), cache.get_keep_alive(), V::size);
+                return status_code::OK;
+            }
+        }
+
+        write_status_line(st, cache.get_ver(), m_code);
+        set_connection_header(st, cache.get_keep_alive());
+
+        // Response block is passed to send callback as is, without copying
+        // to the stream buffer, if it doesn't fit. Sink, that can keep it
+        // until socket takes it, gets it without copying at all.
+        const char* response = reinterpret_cast<const char*>(V::response);
+
+        if(!st.send_static(response, size))
+        {
+            st.write(response, size);
+        }
+
+        st.flush();
+
+        return status_code::OK;
     }
 
-    virtual status_code get_status_code()                      noexcept override
+    // Rendered headers open with Content-Length of the whole variant,
+    // the rest of them is the same for partial content.
+    template<typename V>
+    void write_range(ST&              st,
+                     i_request_cache& cache,
+                     range_t          r)                                noexcept
     {
-        return m_code;
+        write_status_line(st, cache.get_ver(), status_code::PARTIAL_CONTENT);
+        set_connection_header(st, cache.get_keep_alive());
+        set_content_range_header(st, r, V::size);
+        set_content_length_header(st, r.second);
+        st.write(reinterpret_cast<const char*>(V::response) + V::length_size,
+                 V::headers_size - V::length_size);
+
+        const char* data = reinterpret_cast<const char*>(V::data) + r.first;
+
+        if(!st.send_static(data, r.second))
+        {
+            st.write(data, r.second);
+        }
+
+        st.flush();
     }
 
-private:
     content_type m_type { content_type::TEXT_HTML };
     status_code  m_code { status_code::OK };
 };
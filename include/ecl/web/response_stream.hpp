@@ -0,0 +1,259 @@
+#ifndef ECL_WEB_RESPONSE_STREAM_HPP
+#define ECL_WEB_RESPONSE_STREAM_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#include <ecl/stream.hpp>
+
+#include <ecl/web/types.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Sink of the base stream, passes flushed data to response_stream framing.
+template<typename STREAM>
+struct frame_sink
+{
+    void write(const char* const buf, std::size_t size)
+    {
+        m_stream->frame(buf, size);
+    }
+
+    STREAM* m_stream;
+};
+
+// Sinks, that send files by descriptor (socket_sink), have send_file().
+template<typename SINK>
+auto sink_send_file(SINK&       s,
+                    int         fd,
+                    std::size_t offset,
+                    std::size_t size,
+                    int) -> decltype(s.send_file(fd, offset, size))
+{
+    return s.send_file(fd, offset, size);
+}
+
+template<typename SINK>
+bool sink_send_file(SINK&, int, std::size_t, std::size_t, ...)
+{
+    return false;
+}
+
+template<typename SINK>
+auto sink_send_static(SINK&             s,
+                      const char* const buf,
+                      std::size_t       size,
+                      int) -> decltype(s.send_static(buf, size))
+{
+    return s.send_static(buf, size);
+}
+
+template<typename SINK>
+bool sink_send_static(SINK&, const char* const, std::size_t, ...)
+{
+    return false;
+}
+
+// Output stream of the connection. Same as ecl::stream, but body can be sent
+// with chunked transfer-encoding: after begin_chunked() every flush is sent
+// as one chunk, end object (or end_chunked()) sends the last chunk.
+// Data is passed to SINK, see ecl::stream for sink types.
+template<std::size_t BUFFER_SIZE, typename SINK = send_callback_t>
+class response_stream
+    : public ecl::stream<BUFFER_SIZE, frame_sink<response_stream<BUFFER_SIZE, SINK>>>
+{
+public:
+    using base_t = ecl::stream<BUFFER_SIZE, frame_sink<response_stream>>;
+    using sink_t = SINK;
+
+    explicit response_stream(sink_t cb = sink_t())                      noexcept
+        : base_t ( frame_sink<response_stream> { this } )
+        , m_send ( cb )
+    {}
+
+    void set_flush_function(sink_t cb)                                  noexcept
+    {
+        m_send = cb;
+    }
+
+    bool is_chunked()                                             const noexcept
+    {
+        return m_chunked;
+    }
+
+    // Sends buffered data (status line and headers) as is.
+    void begin_chunked()
+    {
+        base_t::flush();
+
+        m_chunked     = true;
+        m_first_chunk = true;
+    }
+
+    // Sends buffered data as chunk and then the last chunk.
+    void end_chunked()
+    {
+        base_t::flush();
+
+        if(m_chunked)
+        {
+            // CRLF of the previous chunk data is sent with the next chunk
+            // header, so each chunk costs two send calls.
+            static const char last_chunk[] = "\r\n0\r\n\r\n";
+            std::size_t       offset       = m_first_chunk ? 2 : 0;
+
+            send(last_chunk + offset, sizeof(last_chunk) - 1 - offset);
+        }
+
+        m_chunked = false;
+    }
+
+    // Sends buffered data and then size bytes of file from offset, if sink
+    // can send file without reading it (see socket_sink). Returns false,
+    // if it can't, caller sends file data itself then.
+    bool send_file(int fd, std::size_t offset, std::size_t size)
+    {
+        base_t::flush();
+
+        return !m_chunked                                &&
+               (nullptr == m_capture)                    &&
+               ecl::detail::sink_is_set(m_send, 0)       &&
+               sink_send_file(m_send, fd, offset, size, 0);
+    }
+
+    // Sends buffered data and then data, that stays valid until it is sent
+    // (static resource data), if sink can keep it instead of buffering
+    // (see socket_sink). Returns false, if it can't, caller writes data
+    // then.
+    bool send_static(const char* const buf, std::size_t size)
+    {
+        base_t::flush();
+
+        return !m_chunked                                &&
+               (nullptr == m_capture)                    &&
+               ecl::detail::sink_is_set(m_send, 0)       &&
+               sink_send_static(m_send, buf, size, 0);
+    }
+
+    // Sent data is copied to buf as well, until end_capture().
+    void begin_capture(char* buf, std::size_t size)
+    {
+        base_t::flush();
+
+        m_capture      = buf;
+        m_capture_size = size;
+        m_captured     = 0;
+    }
+
+    // Returns size of captured data, 0 if it didn't fit.
+    std::size_t end_capture()
+    {
+        base_t::flush();
+
+        std::size_t captured = (nullptr != m_capture) ? m_captured : 0;
+
+        m_capture      = nullptr;
+        m_capture_size = 0;
+        m_captured     = 0;
+
+        return captured;
+    }
+
+    response_stream& operator<< (const end&)
+    {
+        end_chunked();
+        base_t::operator<<(rst());
+
+        return *this;
+    }
+
+    template<typename T>
+    response_stream& operator<< (const T& val)
+    {
+        base_t::operator<<(val);
+        return *this;
+    }
+
+private:
+    response_stream(const response_stream& other)                      = delete;
+    response_stream& operator= (const response_stream& other)          = delete;
+    response_stream(const response_stream&& other)                     = delete;
+    response_stream& operator= (const response_stream&& other)         = delete;
+
+    friend frame_sink<response_stream>;
+
+    void frame(const char* const buf, std::size_t size)
+    {
+        if(!m_chunked)
+        {
+            send(buf, size);
+            return;
+        }
+
+        if(0 == size)
+        {
+            return;
+        }
+
+        // "\r\n" + hex size + "\r\n"
+        char        header[2 + 2 * sizeof(std::size_t) + 2];
+        std::size_t pos = sizeof(header);
+
+        header[--pos] = '\n';
+        header[--pos] = '\r';
+
+        for(std::size_t s = size; 0 != s; s >>= 4)
+        {
+            header[--pos] = "0123456789abcdef"[s & 0xf];
+        }
+
+        if(!m_first_chunk)
+        {
+            header[--pos] = '\n';
+            header[--pos] = '\r';
+        }
+
+        m_first_chunk = false;
+
+        send(header + pos, sizeof(header) - pos);
+        send(buf, size);
+    }
+
+    void send(const char* const buf, std::size_t size)
+    {
+        if(nullptr != m_capture)
+        {
+            if(size > m_capture_size - m_captured)
+            {
+                m_capture = nullptr;
+            }
+            else
+            {
+                std::memcpy(m_capture + m_captured, buf, size);
+                m_captured += size;
+            }
+        }
+
+        if(ecl::detail::sink_is_set(m_send, 0))
+        {
+            ecl::detail::sink_write(m_send, buf, size, 0);
+        }
+    }
+
+    sink_t          m_send         {};
+    bool            m_chunked      { false };
+    bool            m_first_chunk  { false };
+    char*           m_capture      { nullptr };
+    std::size_t     m_capture_size { 0 };
+    std::size_t     m_captured     { 0 };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_RESPONSE_STREAM_HPP
@@ -0,0 +1,161 @@
+#ifndef ECL_WEB_ROUTE_TABLE_HPP
+#define ECL_WEB_ROUTE_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <ecl/web/types.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+using url_hash_t = uint32_t;
+
+constexpr url_hash_t URL_HASH_BASIS = 2166136261u;
+constexpr url_hash_t URL_HASH_PRIME = 16777619u;
+
+// FNV-1a. Can be evaluated at compile time for name types. It recurses once
+// per character, so URLs of requests are hashed by runtime_url_hash().
+constexpr url_hash_t url_hash(const char* url,
+                              url_hash_t  h = URL_HASH_BASIS)           noexcept
+{
+    return (0 == *url) ? h
+                       : url_hash(url + 1,
+                                  (h ^ static_cast<uint8_t>(*url)) * URL_HASH_PRIME);
+}
+
+// Same FNV-1a, iterative.
+inline url_hash_t runtime_url_hash(const char* url)                     noexcept
+{
+    url_hash_t h = URL_HASH_BASIS;
+
+    for(; 0 != *url; ++url)
+    {
+        h = (h ^ static_cast<uint8_t>(*url)) * URL_HASH_PRIME;
+    }
+
+    return h;
+}
+
+// Exact match routing table. Entries are kept sorted by URL hash, so lookup
+// is a binary search over hashes and one strcmp for the found entry.
+// Lookup never modifies the table.
+template<typename RESOURCE, std::size_t ROUTES_COUNT>
+class route_table
+{
+public:
+    using resource_t = RESOURCE;
+
+    // Hash of the name type URL is calculated at compile time.
+    template<typename NAME>
+    bool attach(resource_t& res)                                        noexcept
+    {
+        return attach(NAME::name(),
+                      std::integral_constant
+                      <
+                            url_hash_t
+                          , url_hash(NAME::name())
+                      >::value,
+                      res);
+    }
+
+    bool attach(url_t url, resource_t& res)                             noexcept
+    {
+        return attach(url, runtime_url_hash(url), res);
+    }
+
+    resource_t* find(url_t url)                                   const noexcept
+    {
+        if(nullptr == url)
+        {
+            return nullptr;
+        }
+
+        return find(url, runtime_url_hash(url));
+    }
+
+    std::size_t size()                                            const noexcept
+    {
+        return m_count;
+    }
+
+private:
+    struct route
+    {
+        url_hash_t  m_hash;
+        url_t       m_url;
+        resource_t* m_res;
+    };
+
+    resource_t* find(url_t url, url_hash_t h)                     const noexcept
+    {
+        for(std::size_t i = lower_bound(h);
+            (i < m_count) && (m_routes[i].m_hash == h);
+            ++i)
+        {
+            if(0 == std::strcmp(m_routes[i].m_url, url))
+            {
+                return m_routes[i].m_res;
+            }
+        }
+
+        return nullptr;
+    }
+
+    bool attach(url_t url, url_hash_t h, resource_t& res)               noexcept
+    {
+        if((m_count >= ROUTES_COUNT) || (nullptr != find(url, h)))
+        {
+            return false;
+        }
+
+        std::size_t pos = lower_bound(h);
+
+        for(std::size_t i = m_count; i > pos; --i)
+        {
+            m_routes[i] = m_routes[i - 1];
+        }
+
+        m_routes[pos] = { h, url, &res };
+        ++m_count;
+
+        return true;
+    }
+
+    std::size_t lower_bound(url_hash_t h)                         const noexcept
+    {
+        std::size_t first = 0;
+        std::size_t count = m_count;
+
+        while(count > 0)
+        {
+            std::size_t step = count / 2;
+
+            if(m_routes[first + step].m_hash < h)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+
+        return first;
+    }
+
+    route       m_routes[ROUTES_COUNT] {};
+    std::size_t m_count                { 0 };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_ROUTE_TABLE_HPP
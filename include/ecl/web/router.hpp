@@ -0,0 +1,340 @@
+#ifndef ECL_WEB_ROUTER_HPP
+#define ECL_WEB_ROUTER_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#include <ecl/web/types.hpp>
+#include <ecl/web/i_request_cache.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Pattern routing on compressed trie (radix tree) with statically allocated
+// nodes. Pattern may contain:
+//  {name} - captures non-empty path segment up to the next '/'.
+//  *      - at the end of pattern, captures the rest of the path as "*".
+// Static edges are preferred over captures, captures over wildcard.
+// Patterns are not copied and must outlive the router.
+template
+<
+      typename    RESOURCE
+    , std::size_t NODES_COUNT  = 32
+    , std::size_t PARAMS_COUNT = 4
+>
+class router
+{
+public:
+    using resource_t = RESOURCE;
+
+    static bool is_pattern(url_t url)                                   noexcept
+    {
+        return nullptr != std::strpbrk(url, "{*");
+    }
+
+    bool attach(url_t pattern, resource_t& res)                         noexcept
+    {
+        std::size_t n = make_root();
+        const char* p = pattern;
+
+        while((NONE != n) && (0 != *p))
+        {
+            if('{' == *p)
+            {
+                const char* end = std::strchr(p, '}');
+                if((nullptr == end) || (end == p + 1))
+                {
+                    return false;
+                }
+
+                n = child(n, node_kind::PARAM, p + 1, end - p - 1);
+                p = end + 1;
+            }
+            else if('*' == *p)
+            {
+                if(0 != p[1])
+                {
+                    return false;
+                }
+
+                n = child(n, node_kind::WILDCARD, wildcard_name(), 1);
+                ++p;
+            }
+            else
+            {
+                std::size_t length = std::strcspn(p, "{*");
+
+                n = static_child(n, p, length);
+                p += length;
+            }
+        }
+
+        if((NONE == n) || (nullptr != m_nodes[n].m_res))
+        {
+            return false;
+        }
+
+        m_nodes[n].m_res = &res;
+
+        return true;
+    }
+
+    // Captured values are passed to cache.
+    resource_t* find(url_t path, i_request_cache& cache)          const noexcept
+    {
+        if((nullptr == path) || (0 == m_count))
+        {
+            return nullptr;
+        }
+
+        match_t m {};
+
+        if(!match(root(), path, m))
+        {
+            return nullptr;
+        }
+
+        for(std::size_t i = 0; i < m.m_captures_count; ++i)
+        {
+            cache.set_param(m.m_captures[i].first, m.m_captures[i].second);
+        }
+
+        return m_nodes[m.m_node].m_res;
+    }
+
+private:
+    enum class node_kind
+    {
+          STATIC
+        , PARAM
+        , WILDCARD
+    };
+
+    struct node
+    {
+        node_kind   m_kind;
+        const char* m_label;
+        std::size_t m_length;
+        std::size_t m_child;
+        std::size_t m_sibling;
+        resource_t* m_res;
+    };
+
+    using capture_t = std::pair<fragment_t, fragment_t>;
+
+    struct match_t
+    {
+        std::size_t m_node;
+        capture_t   m_captures[PARAMS_COUNT];
+        std::size_t m_captures_count;
+    };
+
+    constexpr static std::size_t NONE = NODES_COUNT;
+
+    static const char* wildcard_name()                                  noexcept
+    {
+        return "*";
+    }
+
+    std::size_t make_root()                                             noexcept
+    {
+        if(0 == m_count)
+        {
+            m_nodes[0] = { node_kind::STATIC, "", 0, NONE, NONE, nullptr };
+            m_count = 1;
+        }
+
+        return root();
+    }
+
+    constexpr static std::size_t root()                                 noexcept
+    {
+        return 0;
+    }
+
+    std::size_t add(std::size_t parent,
+                    node_kind   kind,
+                    const char* label,
+                    std::size_t length)                                 noexcept
+    {
+        if(m_count >= NODES_COUNT)
+        {
+            return NONE;
+        }
+
+        std::size_t n = m_count++;
+
+        m_nodes[n] = { kind, label, length, NONE, m_nodes[parent].m_child, nullptr };
+        m_nodes[parent].m_child = n;
+
+        return n;
+    }
+
+    // Capture or wildcard child with given name.
+    std::size_t child(std::size_t parent,
+                      node_kind   kind,
+                      const char* label,
+                      std::size_t length)                               noexcept
+    {
+        for(std::size_t c = m_nodes[parent].m_child;
+            NONE != c;
+            c = m_nodes[c].m_sibling)
+        {
+            if((m_nodes[c].m_kind == kind)       &&
+               (m_nodes[c].m_length == length)   &&
+               (0 == std::strncmp(m_nodes[c].m_label, label, length)))
+            {
+                return c;
+            }
+        }
+
+        return add(parent, kind, label, length);
+    }
+
+    // Walks static edges, splitting them on partial match.
+    std::size_t static_child(std::size_t parent,
+                             const char* label,
+                             std::size_t length)                        noexcept
+    {
+        while(0 != length)
+        {
+            std::size_t c = m_nodes[parent].m_child;
+
+            while((NONE != c) &&
+                  ((node_kind::STATIC != m_nodes[c].m_kind) ||
+                   (m_nodes[c].m_label[0] != label[0])))
+            {
+                c = m_nodes[c].m_sibling;
+            }
+
+            if(NONE == c)
+            {
+                return add(parent, node_kind::STATIC, label, length);
+            }
+
+            std::size_t common = 0;
+            while((common < length)              &&
+                  (common < m_nodes[c].m_length) &&
+                  (m_nodes[c].m_label[common] == label[common]))
+            {
+                ++common;
+            }
+
+            if(common < m_nodes[c].m_length)
+            {
+                if(m_count >= NODES_COUNT)
+                {
+                    return NONE;
+                }
+
+                std::size_t s = m_count++;
+
+                m_nodes[s] = {
+                      node_kind::STATIC
+                    , m_nodes[c].m_label + common
+                    , m_nodes[c].m_length - common
+                    , m_nodes[c].m_child
+                    , NONE
+                    , m_nodes[c].m_res
+                };
+
+                m_nodes[c].m_length = common;
+                m_nodes[c].m_child  = s;
+                m_nodes[c].m_res    = nullptr;
+            }
+
+            parent  = c;
+            label  += common;
+            length -= common;
+        }
+
+        return parent;
+    }
+
+    bool match(std::size_t n, const char* path, match_t& m)       const noexcept
+    {
+        if((0 == *path) && (nullptr != m_nodes[n].m_res))
+        {
+            m.m_node = n;
+            return true;
+        }
+
+        for(std::size_t c = m_nodes[n].m_child; NONE != c; c = m_nodes[c].m_sibling)
+        {
+            if((node_kind::STATIC == m_nodes[c].m_kind) &&
+               (0 == std::strncmp(path, m_nodes[c].m_label, m_nodes[c].m_length)) &&
+               match(c, path + m_nodes[c].m_length, m))
+            {
+                return true;
+            }
+        }
+
+        for(std::size_t c = m_nodes[n].m_child; NONE != c; c = m_nodes[c].m_sibling)
+        {
+            if(node_kind::PARAM != m_nodes[c].m_kind)
+            {
+                continue;
+            }
+
+            std::size_t length = std::strcspn(path, "/");
+            if(0 == length)
+            {
+                continue;
+            }
+
+            std::size_t count = m.m_captures_count;
+            capture(m, c, path, length);
+
+            if(match(c, path + length, m))
+            {
+                return true;
+            }
+
+            m.m_captures_count = count;
+        }
+
+        for(std::size_t c = m_nodes[n].m_child; NONE != c; c = m_nodes[c].m_sibling)
+        {
+            if((node_kind::WILDCARD == m_nodes[c].m_kind) &&
+               (nullptr != m_nodes[c].m_res))
+            {
+                capture(m, c, path, std::strlen(path));
+                m.m_node = c;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void capture(match_t&    m,
+                 std::size_t n,
+                 const char* value,
+                 std::size_t length)                              const noexcept
+    {
+        if(m.m_captures_count < PARAMS_COUNT)
+        {
+            m.m_captures[m.m_captures_count++] = std::make_pair
+                                                 (
+                                                       std::make_pair
+                                                       (
+                                                             m_nodes[n].m_label
+                                                           , m_nodes[n].m_length
+                                                       )
+                                                     , std::make_pair(value, length)
+                                                 );
+        }
+    }
+
+    node        m_nodes[NODES_COUNT] {};
+    std::size_t m_count              { 0 };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_ROUTER_HPP
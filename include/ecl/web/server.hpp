@@ -1,12 +1,15 @@
 #ifndef ECL_WEB_SERVER_HPP
 #define ECL_WEB_SERVER_HPP
 
-#include <cstring>
-
 #include "http_parser.h"
 
+#include <ecl/web/connection.hpp>
+#include <ecl/web/limits.hpp>
 #include <ecl/web/request_cache.hpp>
 #include <ecl/web/resource.hpp>
+#include <ecl/web/response_stream.hpp>
+#include <ecl/web/route_table.hpp>
+#include <ecl/web/router.hpp>
 #include <ecl/web/types.hpp>
 
 #include <ecl/map.hpp>
@@ -25,11 +28,16 @@ template
     , std::size_t HEADERS_COUNT      = 32
     , std::size_t RESOURCES_COUNT    = 16
     , std::size_t MAX_HANDLERS_COUNT = 40
+    , std::size_t CONNECTIONS_COUNT  = 1
+    , std::size_t ROUTES_NODES_COUNT = 32
+    , template<std::size_t, std::size_t> class REQUEST_CACHE = request_cache
+    , typename    SINK               = send_callback_t
 >
 class server
 {
 public:
-    using stream_t            = ecl::stream<OUT_STREAM_SIZE>;
+    using sink_t              = SINK;
+    using stream_t            = response_stream<OUT_STREAM_SIZE, sink_t>;
 
     template<typename T>
     using resource_t          = static_resource<T, stream_t>;
@@ -40,225 +48,210 @@ public:
     using i_resource_t        = i_resource<stream_t>;
     using i_static_resource_t = i_static_resource<stream_t>;
 
-private:
-    template<typename T>
-    struct char_ptr_cmp
-    {
-        bool operator()(char const *a, char const *b)
-        {
-           return (std::strcmp(a, b) < 0);
-        }
-    };
-
-    using request_cache_t = request_cache<CACHE_SIZE, HEADERS_COUNT>;
-    using resources_map_t = ecl::map
-                            <
-                                  url_t
-                                , i_resource_t*
-                                , RESOURCES_COUNT
-                                , char_ptr_cmp
-                            >;
+    using request_cache_t     = REQUEST_CACHE<CACHE_SIZE, HEADERS_COUNT>;
+    using connection_t        = connection<server>;
 
-    using handlers_map_t = ecl::map<status_code, i_static_resource_t*, MAX_HANDLERS_COUNT>;
+    constexpr static std::size_t connections_count = CONNECTIONS_COUNT;
 
-    int on_message_begin()
-    {
-        m_cache.clear();
-        return 0;
-    }
+private:
+    using resources_table_t = route_table<i_resource_t, RESOURCES_COUNT>;
+    using router_t          = router<i_resource_t, ROUTES_NODES_COUNT>;
 
-    int on_url(const char* at, std::size_t length)
-    {
-        const_cast<char*>(at)[length] = 0;
-        m_cache.set_url(at);
+    using handlers_map_t = ecl::map<status_code, i_static_resource_t*, MAX_HANDLERS_COUNT>;
 
-        return 0;
-    }
+public:
+    server()                                                            noexcept
+    {}
 
-    int on_status(const char*, std::size_t)
-    {
-        return 0;
-    }
+    explicit server(sink_t cb)                                          noexcept
+        : m_default ( open(cb) )
+    {}
 
-    int on_header_field(const char* at, std::size_t length)
+    connection_t* open(sink_t cb)                                       noexcept
     {
-        const_cast<char*>(at)[length] = 0;
-        m_hdr.first = at;
+        for(auto& c : m_connections)
+        {
+            if(!c.is_open())
+            {
+                c.open(this, cb);
+                return &c;
+            }
+        }
 
-        return 0;
+        return nullptr;
     }
 
-    int on_header_value(const char* at, std::size_t length)
+    void close(connection_t* c)                                         noexcept
     {
-        const_cast<char*>(at)[length] = 0;
-        m_hdr.second = at;
-
-        m_cache.set_hdr(m_hdr);
+        if(nullptr == c)
+        {
+            return;
+        }
 
-        return 0;
-    }
+        if(m_default == c)
+        {
+            m_default = nullptr;
+        }
 
-    int on_headers_complete()
-    {
-        return 0;
+        c->close();
     }
 
-    int on_body(const char* at, std::size_t length)
+    // Request for default connection. Connection is restarted when previous
+    // request closed it, as caller can't reopen default connection.
+    void process_request(const char* buf, std::size_t buf_size)         noexcept
     {
-        const_cast<char*>(at)[length] = 0;
-        m_cache.set_body(std::make_pair(at, length));
+        if(nullptr == m_default)
+        {
+            return;
+        }
 
-        return 0;
-    }
+        if(!m_default->is_keep_alive())
+        {
+            m_default->restart();
+        }
 
-    int on_message_complete()
-    {
-        call_resource();
-        return 0;
+        m_default->process_request(buf, buf_size);
     }
 
-    int on_chunk_header()
+    // Data of default connection, that is kept for the next request.
+    fragment_t get_pending()                                            noexcept
     {
-        return 0;
-    }
+        if(nullptr == m_default)
+        {
+            return fragment_t(nullptr, 0);
+        }
 
-    int on_chunk_complete()
-    {
-        return 0;
+        return m_default->get_pending();
     }
 
-    static int on_message_begin_static    (http_parser* p)
+    // URL may be a pattern with prefix wildcard or captured segments.
+    // See @ref router.
+    bool attach_resource(url_t url, i_resource_t& res)                  noexcept
     {
-        return static_cast<server*>(p->data)->on_message_begin();
-    }
+        if(router_t::is_pattern(url))
+        {
+            return m_router.attach(url, res);
+        }
 
-    static int on_url_static              (http_parser* p, const char* at, std::size_t length)
-    {
-        return static_cast<server*>(p->data)->on_url(at, length);
+        return m_resources.attach(url, res);
     }
 
-    static int on_status_static           (http_parser* p, const char* at, std::size_t length)
+    template<typename NAME>
+    bool attach_resource(i_resource_t& res)                             noexcept
     {
-        return static_cast<server*>(p->data)->on_status(at, length);
-    }
+        if(router_t::is_pattern(NAME::name()))
+        {
+            return m_router.attach(NAME::name(), res);
+        }
 
-    static int on_header_field_static     (http_parser* p, const char* at, std::size_t length)
-    {
-        return static_cast<server*>(p->data)->on_header_field(at, length);
+        return m_resources.template attach<NAME>(res);
     }
 
-    static int on_header_value_static     (http_parser* p, const char* at, std::size_t length)
+    bool attach_handler(i_static_resource_t& handler)                   noexcept
     {
-        return static_cast<server*>(p->data)->on_header_value(at, length);
+        return m_handlers.insert(std::make_pair
+                                 (
+                                       handler.get_status_code()
+                                     , &handler)
+                                 ).second;
     }
 
-    static int on_headers_complete_static (http_parser* p)
+    // Resources and handlers are looked up in tables of owner, own tables
+    // are not used anymore. Owner must outlive this server, its tables must
+    // not be changed while servers run in other threads.
+    void share_resources(const server& owner)                           noexcept
     {
-        return static_cast<server*>(p->data)->on_headers_complete();
+        m_tables = &owner;
     }
 
-    static int on_body_static             (http_parser* p, const char* at, std::size_t length)
+    void set_limits(const request_limits& l)                            noexcept
     {
-        return static_cast<server*>(p->data)->on_body(at, length);
+        m_limits = l;
     }
 
-    static int on_message_complete_static (http_parser* p)
+    const request_limits& get_limits()                            const noexcept
     {
-        return static_cast<server*>(p->data)->on_message_complete();
+        return m_limits;
     }
 
-    static int on_chunk_header_static     (http_parser* p)
+    // Advances time of all open connections. Connections, that ran out of
+    // time, are not keep-alive anymore, caller should close their sockets.
+    void tick()                                                         noexcept
     {
-        return static_cast<server*>(p->data)->on_chunk_header();
+        for(auto& c : m_connections)
+        {
+            c.tick();
+        }
     }
 
-    static int on_chunk_complete_static   (http_parser* p)
-    {
-        return static_cast<server*>(p->data)->on_chunk_complete();
-    }
+private:
+    friend connection_t;
 
-public:
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-    server(send_callback_t cb)
-        : m_stream { cb }
-    {
-#pragma GCC diagnostic pop
-        http_parser_init(&m_parser, HTTP_REQUEST);
-
-        m_parser.data = this;
-
-        m_parser_settings.on_message_begin    = on_message_begin_static;
-        m_parser_settings.on_url              = on_url_static;
-        m_parser_settings.on_status           = on_status_static;
-        m_parser_settings.on_header_field     = on_header_field_static;
-        m_parser_settings.on_header_value     = on_header_value_static;
-        m_parser_settings.on_headers_complete = on_headers_complete_static;
-        m_parser_settings.on_body             = on_body_static;
-        m_parser_settings.on_message_complete = on_message_complete_static;
-        m_parser_settings.on_chunk_header     = on_chunk_header_static;
-        m_parser_settings.on_chunk_complete   = on_chunk_complete_static;
-    }
+    server(const server& other)                                        = delete;
+    server& operator= (const server& other)                            = delete;
+    server(const server&& other)                                       = delete;
+    server& operator= (const server&& other)                           = delete;
 
-    void process_request(const char* buf, std::size_t buf_size)         noexcept
+    // Called as soon as request headers are parsed, so resource may take
+    // request body as it arrives. Captured parameters are set to cache.
+    i_resource_t* find_resource(request_cache_t& cache)                 noexcept
     {
-        m_cache.cache(buf, buf_size);
-
-        http_parser_execute(&m_parser,
-                            &m_parser_settings,
-                            m_cache.get_raw_rq(),
-                            m_cache.get_raw_rq_size());
-    }
+        url_field_t   path = cache.get_url(url_field::PATH);
+        i_resource_t* res  = m_tables->m_resources.find(path);
 
-    bool attach_resource(url_t url, i_resource_t& res)                  noexcept
-    {
-        return m_resources.insert(std::make_pair(url, &res)).second;
-    }
+        if(nullptr == res)
+        {
+            res = m_tables->m_router.find(path, cache);
+        }
 
-    bool attach_handler(i_static_resource_t& handler)                   noexcept
-    {
-        return m_handlers.insert(std::make_pair
-                                 (
-                                       handler.get_status_code()
-                                     , &handler)
-                                 ).second;
+        return res;
     }
 
-private:
-    void call_resource()
+    void call_resource(stream_t&        st,
+                       request_cache_t& cache,
+                       i_resource_t*    res)                            noexcept
     {
-        i_resource_t* res = m_resources[m_cache.get_url(url_field::PATH)];
-
         status_code result = status_code::NOT_FOUND;
         if(nullptr != res)
         {
-            result = res->on_request(m_stream, m_cache);
+            result = res->on_request(st, cache);
         }
 
         if(is_error(result))
         {
-            if(nullptr != m_handlers[result])
-            {
-                m_handlers[result]->on_request(m_stream, m_cache);
-            }
-            else
-            {
-                write_status_line(m_stream, version::HTTP11, status_code::NOT_FOUND);
-            }
+            call_handler(st, cache, result);
         }
     }
 
-    stream_t             m_stream          {};
+    void call_handler(stream_t&        st,
+                      request_cache_t& cache,
+                      status_code      code)                            noexcept
+    {
+        auto handler_it = m_tables->m_handlers.find(code);
+        if(m_tables->m_handlers.end() != handler_it)
+        {
+            if(!is_error(handler_it->second->on_request(st, cache)))
+            {
+                return;
+            }
+        }
 
-    http_parser          m_parser          {};
-    http_parser_settings m_parser_settings {};
+        write_status_line(st, cache.get_ver(), code);
+        set_content_length_header(st, 0);
+        set_connection_header(st, cache.get_keep_alive());
+        st << "\r\n";
+        st.flush();
+    }
 
-    header_t             m_hdr             {};
+    connection_t      m_connections[CONNECTIONS_COUNT] {};
+    connection_t*     m_default                        { nullptr };
 
-    request_cache_t      m_cache           {};
+    resources_table_t m_resources                      {};
+    router_t          m_router                         {};
+    handlers_map_t    m_handlers                       {};
+    const server*     m_tables                         { this };
 
-    resources_map_t      m_resources       {};
-    handlers_map_t       m_handlers        {};
+    request_limits    m_limits                         {};
 };
 
 } // namespace web
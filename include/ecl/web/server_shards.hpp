@@ -0,0 +1,171 @@
+#ifndef ECL_WEB_SERVER_SHARDS_HPP
+#define ECL_WEB_SERVER_SHARDS_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <ecl/web/event_loop.hpp>
+#include <ecl/web/limits.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Multi-threaded front-end for Linux. Each shard is a server with its own
+// connections and event loop, that runs in its own thread pinned to its
+// own core. All shards listen on the same port (SO_REUSEPORT), so kernel
+// balances connections between them and shards share nothing but resource
+// tables.
+// Resources are attached to tables() before start(). They are called from
+// all threads at once, so resources with state must synchronize it
+// themselves; static resources are read-only.
+template
+<
+      typename    SERVER
+    , std::size_t SHARDS_COUNT
+    , std::size_t RECV_BUFFER_SIZE = 2048
+    , std::size_t SEND_BUFFER_SIZE = 16384
+>
+class server_shards
+{
+public:
+    using server_t = SERVER;
+    using loop_t   = event_loop<server_t, RECV_BUFFER_SIZE, SEND_BUFFER_SIZE>;
+
+    static_assert(SHARDS_COUNT > 0, "At least one shard is required");
+
+    server_shards()                                                     noexcept
+    {
+        for(std::size_t i = 1; i < SHARDS_COUNT; ++i)
+        {
+            m_shards[i].m_server.share_resources(tables());
+        }
+    }
+
+    ~server_shards()                                                    noexcept
+    {
+        stop();
+    }
+
+    // Server of the first shard, its tables are used by all shards.
+    server_t& tables()                                                  noexcept
+    {
+        return m_shards[0].m_server;
+    }
+
+    void set_limits(const request_limits& l)                            noexcept
+    {
+        for(auto& s : m_shards)
+        {
+            s.m_server.set_limits(l);
+        }
+    }
+
+    // Opens listen sockets of all shards and starts their threads.
+    // Port "0" picks any free port, the same one for all shards.
+    bool start(const char* port, int tick_ms)                           noexcept
+    {
+        if(!m_shards[0].m_loop.open(port, true))
+        {
+            return false;
+        }
+
+        char shared_port[8];
+        std::snprintf(shared_port, sizeof(shared_port), "%u", this->port());
+
+        for(std::size_t i = 1; i < SHARDS_COUNT; ++i)
+        {
+            if(!m_shards[i].m_loop.open(shared_port, true))
+            {
+                for(std::size_t j = 0; j < i; ++j)
+                {
+                    m_shards[j].m_loop.close();
+                }
+
+                return false;
+            }
+        }
+
+        unsigned cores = std::thread::hardware_concurrency();
+
+        for(std::size_t i = 0; i < SHARDS_COUNT; ++i)
+        {
+            shard* s = &m_shards[i];
+
+            s->m_thread = std::thread([s, tick_ms]()
+                                      {
+                                          s->m_loop.run(tick_ms);
+                                      });
+
+            if(0 != cores)
+            {
+                pin(s->m_thread, i % cores);
+            }
+        }
+
+        return true;
+    }
+
+    // Stops all shards and waits for their threads.
+    void stop()                                                         noexcept
+    {
+        for(auto& s : m_shards)
+        {
+            s.m_loop.stop();
+        }
+
+        for(auto& s : m_shards)
+        {
+            if(s.m_thread.joinable())
+            {
+                s.m_thread.join();
+            }
+
+            s.m_loop.close();
+        }
+    }
+
+    // Port of listen sockets in host byte order, 0 if they aren't open.
+    unsigned short port()                                         const noexcept
+    {
+        return m_shards[0].m_loop.port();
+    }
+
+private:
+    server_shards(const server_shards& other)                          = delete;
+    server_shards& operator= (const server_shards& other)              = delete;
+    server_shards(const server_shards&& other)                         = delete;
+    server_shards& operator= (const server_shards&& other)             = delete;
+
+    struct shard
+    {
+        server_t    m_server {};
+        loop_t      m_loop   { m_server };
+        std::thread m_thread {};
+    };
+
+    // Shard keeps its connections and caches in cache of one core.
+    // Placement is a hint, thread runs anyway, if it fails.
+    static void pin(std::thread& t, std::size_t core)                   noexcept
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+
+        pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+    }
+
+    shard m_shards[SHARDS_COUNT] {};
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_SERVER_SHARDS_HPP
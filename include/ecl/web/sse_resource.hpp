@@ -0,0 +1,318 @@
+#ifndef ECL_WEB_SSE_RESOURCE_HPP
+#define ECL_WEB_SSE_RESOURCE_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#include <ecl/stream.hpp>
+
+#include <ecl/web/constants.hpp>
+#include <ecl/web/i_request_cache.hpp>
+#include <ecl/web/i_resource.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+// Sink of sse_resource event stream, passes every flushed part of the
+// event to all subscribers.
+template<typename RESOURCE>
+struct sse_fanout_sink
+{
+    void write(const char* const buf, std::size_t size)
+    {
+        m_res->fan_out(buf, size);
+    }
+
+    RESOURCE* m_res;
+};
+
+// Server-Sent Events endpoint. GET is answered with text/event-stream
+// headers and the connection is kept by one of SUBSCRIBERS_COUNT
+// subscribers until the client goes away.
+// publish() serializes an event once to EVENT_BUFFER_SIZE buffer and
+// writes the same bytes to all subscribers, events larger than the buffer
+// are passed in parts. Line breaks of data (CR, LF or CRLF) start new
+// "data:" field, so data can't end the event or inject other fields.
+// Derived resource may override on_subscribe() to send initial state,
+// e.g. since Last-Event-ID.
+// Events must be published from the thread, that runs the server, so a
+// resource can't be shared by server_shards.
+// Requests without keep-alive (HTTP/1.0, "Connection: close") get
+// headers only.
+template
+<
+      typename    ST
+    , std::size_t SUBSCRIBERS_COUNT = 8
+    , std::size_t EVENT_BUFFER_SIZE = 512
+>
+class sse_resource : public i_resource<ST>
+{
+public:
+    using event_stream_t = ecl::stream<EVENT_BUFFER_SIZE, sse_fanout_sink<sse_resource>>;
+
+    sse_resource()                                                      noexcept
+        : m_events ( sse_fanout_sink<sse_resource> { this } )
+    {}
+
+    virtual ~sse_resource()                                    noexcept override
+    {}
+
+    virtual status_code on_request(ST&              st,
+                                   i_request_cache& cache)     noexcept override
+    {
+        if(method::GET != cache.get_met())
+        {
+            return status_code::METHOD_NOT_ALLOWED;
+        }
+
+        m_pending = nullptr;
+
+        for(auto& s : m_subscribers)
+        {
+            if(nullptr == s.m_stream)
+            {
+                m_pending = &s;
+                break;
+            }
+        }
+
+        if(nullptr == m_pending)
+        {
+            return status_code::SERVICE_UNAVAILABLE;
+        }
+
+        write_status_line(st, cache.get_ver(), status_code::OK);
+        set_content_type_header(st, content_type::TEXT_EVENT_STREAM);
+        st << "Cache-Control:no-cache\r\n"
+           << "\r\n";
+
+        on_subscribe(st, cache.get_hdr(header_name::LAST_EVENT_ID));
+
+        st.flush();
+
+        return status_code::OK;
+    }
+
+    // Subscriber, reserved by on_request(), takes the connection.
+    virtual i_session<ST>* open_session(ST& st, i_request_cache&)       noexcept override
+    {
+        subscriber* s = m_pending;
+        m_pending = nullptr;
+
+        if(nullptr != s)
+        {
+            s->m_stream = &st;
+        }
+
+        return s;
+    }
+
+    // Each line of data is sent as "data:" field of the event, event name
+    // and id are optional.
+    void publish(const char* data,
+                 const char* event = nullptr,
+                 const char* id    = nullptr)                           noexcept
+    {
+        write_fields(event, id);
+        begin_data();
+        m_events.write(data, std::strlen(data));
+        end_data();
+    }
+
+    // Value is serialized with ecl::stream operators, lines of the result
+    // are sent as "data:" fields, same as by publish().
+    template<typename T>
+    void publish_value(const T&    value,
+                       const char* event = nullptr,
+                       const char* id    = nullptr)                     noexcept
+    {
+        write_fields(event, id);
+        begin_data();
+        m_events << value;
+        end_data();
+    }
+
+    // Comment line, that keeps idle connections from being dropped by
+    // proxies.
+    void heartbeat()                                                    noexcept
+    {
+        m_events << ":\n\n";
+        m_events.flush();
+
+        flush_subscribers();
+    }
+
+    std::size_t subscribers_count()                               const noexcept
+    {
+        std::size_t count = 0;
+
+        for(auto& s : m_subscribers)
+        {
+            count += (nullptr != s.m_stream) ? 1 : 0;
+        }
+
+        return count;
+    }
+
+protected:
+    // Called after headers, st may be written to.
+    virtual void on_subscribe(ST&, header_value_t /* last_event_id */)  noexcept
+    {}
+
+private:
+    sse_resource(const sse_resource& other)                            = delete;
+    sse_resource& operator= (const sse_resource& other)                = delete;
+    sse_resource(const sse_resource&& other)                           = delete;
+    sse_resource& operator= (const sse_resource&& other)               = delete;
+
+    friend sse_fanout_sink<sse_resource>;
+
+    // Event stream goes one way, data of the client is ignored.
+    struct subscriber : public i_session<ST>
+    {
+        virtual ~subscriber()                                  noexcept override
+        {}
+
+        virtual bool on_data(ST&, const char*, std::size_t)    noexcept override
+        {
+            return true;
+        }
+
+        virtual void on_close(ST&)                             noexcept override
+        {
+            m_stream = nullptr;
+        }
+
+        ST* m_stream { nullptr };
+    };
+
+    void write_fields(const char* event, const char* id)                noexcept
+    {
+        write_field("event:", event);
+        write_field("id:", id);
+    }
+
+    // Field value is one line, CR and LF are dropped, so the value can't
+    // end the event or add fields. Values are NUL-terminated, so NUL,
+    // that makes clients ignore id, can't be sent either.
+    void write_field(const char* name, const char* value)               noexcept
+    {
+        if(nullptr == value)
+        {
+            return;
+        }
+
+        m_events << name;
+
+        while(0 != *value)
+        {
+            std::size_t size = std::strcspn(value, "\r\n");
+
+            m_events.write(value, size);
+            value += size;
+            value += std::strspn(value, "\r\n");
+        }
+
+        m_events << "\n";
+    }
+
+    // Fields are passed as they are written, data is passed with line
+    // breaks replaced.
+    void begin_data()                                                   noexcept
+    {
+        m_events << "data:";
+        m_events.flush();
+
+        m_in_data = true;
+        m_after_cr = false;
+    }
+
+    void end_data()                                                     noexcept
+    {
+        m_events.flush();
+        m_in_data = false;
+
+        m_events << "\n\n";
+        m_events.flush();
+
+        flush_subscribers();
+    }
+
+    // Subscribers are flushed once per event, parts of the event are
+    // buffered by their streams.
+    void fan_out(const char* buf, std::size_t size)                     noexcept
+    {
+        if(!m_in_data)
+        {
+            write_all(buf, size);
+            return;
+        }
+
+        // LF of CRLF may come in the next part.
+        static const char next_line[] = "\ndata:";
+        std::size_t       begin       = 0;
+
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            const bool after_cr = m_after_cr;
+            m_after_cr = ('\r' == buf[i]);
+
+            if(('\r' != buf[i]) && ('\n' != buf[i]))
+            {
+                continue;
+            }
+
+            write_all(buf + begin, i - begin);
+            begin = i + 1;
+
+            if(('\n' != buf[i]) || !after_cr)
+            {
+                write_all(next_line, sizeof(next_line) - 1);
+            }
+        }
+
+        write_all(buf + begin, size - begin);
+    }
+
+    void write_all(const char* buf, std::size_t size)                   noexcept
+    {
+        if(0 == size)
+        {
+            return;
+        }
+
+        for(auto& s : m_subscribers)
+        {
+            if(nullptr != s.m_stream)
+            {
+                s.m_stream->write(buf, size);
+            }
+        }
+    }
+
+    void flush_subscribers()                                            noexcept
+    {
+        for(auto& s : m_subscribers)
+        {
+            if(nullptr != s.m_stream)
+            {
+                s.m_stream->flush();
+            }
+        }
+    }
+
+    subscriber     m_subscribers[SUBSCRIBERS_COUNT] {};
+    subscriber*    m_pending                        { nullptr };
+    event_stream_t m_events;
+    bool           m_in_data                        { false };
+    bool           m_after_cr                       { false };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_SSE_RESOURCE_HPP
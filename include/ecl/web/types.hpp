@@ -2,8 +2,9 @@
 #define ECL_WEB_TYPES_HPP
 
 #include <utility>
-#include <functional>
+#include <new>
 #include <cstddef>
+#include <type_traits>
 
 namespace ecl
 {
@@ -18,11 +19,225 @@ using header_value_t = const char*;
 using header_t       = std::pair<header_name_t, header_value_t>;
 using body_ptr_t     = const char*;
 using body_t         = std::pair<body_ptr_t, std::size_t>;
+using fragment_t     = std::pair<const char*, std::size_t>;
+using param_name_t   = const char*;
+using param_value_t  = const char*;
+using range_t        = std::pair<std::size_t, std::size_t>; // offset, length
 
-using send_callback_t = std::function
-                        <
-                            void(const char* const, std::size_t)
-                        >;
+// Type-erased sink of connections. Any callable is taken, and sinks, that
+// send files by descriptor or keep static data (socket_sink), keep their
+// send_file() and send_static(), so server with default sink doesn't copy
+// them to fixed send buffer.
+// Callable is stored inline (no heap allocation), so it must fit
+// STORAGE_SIZE. Copies of the callback copy the callable, as std::function
+// does; methods of one callback share its state.
+class send_callback
+{
+public:
+    static constexpr std::size_t STORAGE_SIZE = 4 * sizeof(void*);
+
+    send_callback()                                                     noexcept
+    {}
+
+    send_callback(std::nullptr_t)                                       noexcept
+    {}
+
+    template
+    <
+          typename F
+        , typename = typename std::enable_if
+                     <
+                         !std::is_same<typename std::decay<F>::type, send_callback>::value
+                     >::type
+    >
+    send_callback(F f)                                                  noexcept
+    {
+        static_assert(sizeof(F) <= STORAGE_SIZE,
+                      "Sink doesn't fit send_callback storage");
+        static_assert(alignof(F) <= alignof(storage_t),
+                      "Sink alignment exceeds send_callback storage");
+
+        if(!is_empty(f))
+        {
+            new (&m_storage) F(f);
+            m_ops = ops_of<F>();
+        }
+    }
+
+    send_callback(const send_callback& other)                           noexcept
+        : m_ops ( other.m_ops )
+    {
+        if(nullptr != m_ops)
+        {
+            m_ops->copy(&m_storage, &other.m_storage);
+        }
+    }
+
+    send_callback& operator= (const send_callback& other)               noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+
+            if(nullptr != other.m_ops)
+            {
+                other.m_ops->copy(&m_storage, &other.m_storage);
+                m_ops = other.m_ops;
+            }
+        }
+
+        return *this;
+    }
+
+    ~send_callback()                                                    noexcept
+    {
+        reset();
+    }
+
+    // Empty callback drops data.
+    void operator() (const char* const buf, std::size_t size)     const
+    {
+        if(nullptr != m_ops)
+        {
+            m_ops->write(&m_storage, buf, size);
+        }
+    }
+
+    // Returns false, if sink can't send files.
+    bool send_file(int fd, std::size_t offset, std::size_t size)  const
+    {
+        return nullptr != m_ops && m_ops->send_file(&m_storage, fd, offset, size);
+    }
+
+    // Returns false, if sink can't keep static data.
+    bool send_static(const char* const buf, std::size_t size)     const
+    {
+        return nullptr != m_ops && m_ops->send_static(&m_storage, buf, size);
+    }
+
+    explicit operator bool()                                      const noexcept
+    {
+        return nullptr != m_ops;
+    }
+
+private:
+    using storage_t = typename std::aligned_storage
+                      <
+                          STORAGE_SIZE,
+                          alignof(std::max_align_t)
+                      >::type;
+
+    struct ops
+    {
+        void (*copy)        (void*, const void*);
+        void (*destroy)     (void*);
+        void (*write)       (void*, const char* const, std::size_t);
+        bool (*send_file)   (void*, int, std::size_t, std::size_t);
+        bool (*send_static) (void*, const char* const, std::size_t);
+    };
+
+    template<typename F>
+    struct ops_impl
+    {
+        static void copy(void* to, const void* from)
+        {
+            new (to) F(*static_cast<const F*>(from));
+        }
+
+        static void destroy(void* f)
+        {
+            static_cast<F*>(f)->~F();
+        }
+
+        static void write(void* f, const char* const buf, std::size_t size)
+        {
+            (*static_cast<F*>(f))(buf, size);
+        }
+
+        static bool send_file(void* f, int fd, std::size_t offset, std::size_t size)
+        {
+            return file_sender(*static_cast<F*>(f), fd, offset, size, 0);
+        }
+
+        static bool send_static(void* f, const char* const buf, std::size_t size)
+        {
+            return static_sender(*static_cast<F*>(f), buf, size, 0);
+        }
+    };
+
+    template<typename F>
+    static const ops* ops_of()                                          noexcept
+    {
+        static const ops table
+        {
+            &ops_impl<F>::copy,
+            &ops_impl<F>::destroy,
+            &ops_impl<F>::write,
+            &ops_impl<F>::send_file,
+            &ops_impl<F>::send_static
+        };
+
+        return &table;
+    }
+
+    void reset()                                                        noexcept
+    {
+        if(nullptr != m_ops)
+        {
+            m_ops->destroy(&m_storage);
+            m_ops = nullptr;
+        }
+    }
+
+    // Null function pointer makes empty callback, as with std::function.
+    template<typename R, typename... A>
+    static bool is_empty(R (*f)(A...))                                  noexcept
+    {
+        return nullptr == f;
+    }
+
+    template<typename F>
+    static bool is_empty(const F&)                                      noexcept
+    {
+        return false;
+    }
+
+    template<typename F>
+    static auto file_sender(F&          f,
+                            int         fd,
+                            std::size_t offset,
+                            std::size_t size,
+                            int) -> decltype(f.send_file(fd, offset, size))
+    {
+        return f.send_file(fd, offset, size);
+    }
+
+    template<typename F>
+    static bool file_sender(F&, int, std::size_t, std::size_t, ...)
+    {
+        return false;
+    }
+
+    template<typename F>
+    static auto static_sender(F&                f,
+                              const char* const buf,
+                              std::size_t       size,
+                              int) -> decltype(f.send_static(buf, size))
+    {
+        return f.send_static(buf, size);
+    }
+
+    template<typename F>
+    static bool static_sender(F&, const char* const, std::size_t, ...)
+    {
+        return false;
+    }
+
+    mutable storage_t m_storage {};
+    const ops*        m_ops     { nullptr };
+};
+
+using send_callback_t = send_callback;
 
 } // namespace web
 
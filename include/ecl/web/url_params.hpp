@@ -0,0 +1,196 @@
+#ifndef ECL_WEB_URL_PARAMS_HPP
+#define ECL_WEB_URL_PARAMS_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#include <ecl/web/constants.hpp>
+#include <ecl/web/types.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+using url_param_t = std::pair<param_name_t, param_value_t>;
+
+// Parameters of query string or application/x-www-form-urlencoded body.
+// Source is decoded once, in place: pairs are packed to the beginning of
+// the source as "name\0value\0name\0value\0...", so nothing is copied and
+// pairs may be iterated any number of times. Source must be writable up to
+// terminating char (source[length]) and must outlive parameters.
+class url_params
+{
+public:
+    class iterator
+    {
+    public:
+        explicit iterator(const char* p)                                noexcept
+            : m_p ( p )
+        {}
+
+        url_param_t operator* ()                                  const noexcept
+        {
+            return std::make_pair(m_p, value());
+        }
+
+        iterator& operator++ ()                                         noexcept
+        {
+            const char* v = value();
+            m_p = v + std::strlen(v) + 1;
+
+            return *this;
+        }
+
+        bool operator== (const iterator& other)                   const noexcept
+        {
+            return m_p == other.m_p;
+        }
+
+        bool operator!= (const iterator& other)                   const noexcept
+        {
+            return m_p != other.m_p;
+        }
+
+    private:
+        const char* value()                                       const noexcept
+        {
+            return m_p + std::strlen(m_p) + 1;
+        }
+
+        const char* m_p;
+    };
+
+    url_params()                                                        noexcept
+    {}
+
+    url_params(char* source, std::size_t length)                        noexcept
+    {
+        parse(source, length);
+    }
+
+    // Decodes "name=value&name=value..." from source. Pairs without '='
+    // are skipped: there is no room for two terminators in place of them.
+    void parse(char* source, std::size_t length)                        noexcept
+    {
+        m_begin = source;
+        m_end   = source;
+        m_count = 0;
+
+        if(nullptr == source)
+        {
+            return;
+        }
+
+        const char* p   = source;
+        const char* end = source + length;
+        char*       out = source;
+
+        while(p < end)
+        {
+            const char* pair_end = p;
+            while((pair_end < end) && ('&' != *pair_end) && (';' != *pair_end))
+            {
+                ++pair_end;
+            }
+
+            const char* eq = p;
+            while((eq < pair_end) && ('=' != *eq))
+            {
+                ++eq;
+            }
+
+            if(eq < pair_end)
+            {
+                out = decode(p, eq, out);
+                out = decode(eq + 1, pair_end, out);
+
+                ++m_count;
+            }
+
+            p = pair_end + 1;
+        }
+
+        m_end = out;
+    }
+
+    iterator begin()                                              const noexcept
+    {
+        return iterator(m_begin);
+    }
+
+    iterator end()                                                const noexcept
+    {
+        return iterator(m_end);
+    }
+
+    std::size_t size()                                            const noexcept
+    {
+        return m_count;
+    }
+
+    // Value of the first parameter with given name.
+    param_value_t get(param_name_t name)                          const noexcept
+    {
+        return get(name, std::strlen(name));
+    }
+
+    template<typename NAME>
+    param_value_t get()                                           const noexcept
+    {
+        return get(NAME::name(), NAME::size());
+    }
+
+private:
+    param_value_t get(param_name_t name, std::size_t length)      const noexcept
+    {
+        for(url_param_t p : *this)
+        {
+            if((0 == std::strncmp(p.first, name, length)) && (0 == p.first[length]))
+            {
+                return p.second;
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Output never overtakes input, as decoded string is not longer.
+    static char* decode(const char* p, const char* end, char* out)      noexcept
+    {
+        for(; p < end; ++p)
+        {
+            // "%00" and broken escapes are left as is.
+            const int c = percent_decode(p, end);
+
+            if('+' == *p)
+            {
+                *out++ = ' ';
+            }
+            else if(c >= 0)
+            {
+                *out++ = static_cast<char>(c);
+                p += 2;
+            }
+            else
+            {
+                *out++ = *p;
+            }
+        }
+
+        *out++ = 0;
+
+        return out;
+    }
+
+    const char* m_begin { nullptr };
+    const char* m_end   { nullptr };
+    std::size_t m_count { 0 };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_URL_PARAMS_HPP
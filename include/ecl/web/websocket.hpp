@@ -0,0 +1,707 @@
+#ifndef ECL_WEB_WEBSOCKET_HPP
+#define ECL_WEB_WEBSOCKET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <ecl/stream.hpp>
+
+#include <ecl/web/constants.hpp>
+#include <ecl/web/i_request_cache.hpp>
+#include <ecl/web/i_resource.hpp>
+
+namespace ecl
+{
+
+namespace web
+{
+
+enum class ws_opcode : uint8_t
+{
+      CONTINUATION = 0x0
+    , TEXT         = 0x1
+    , BINARY       = 0x2
+    , CLOSE        = 0x8
+    , PING         = 0x9
+    , PONG         = 0xa
+};
+
+// Status codes of close frame (RFC 6455, 7.4.1).
+enum class ws_close : uint16_t
+{
+      NORMAL            = 1000
+    , GOING_AWAY        = 1001
+    , PROTOCOL_ERROR    = 1002
+    , UNSUPPORTED_DATA  = 1003
+    , MESSAGE_TOO_BIG   = 1009
+};
+
+// SHA-1 is needed for the handshake only, it is not used for security.
+class sha1
+{
+public:
+    static constexpr std::size_t digest_size = 20;
+
+    void update(const char* data, std::size_t size)                     noexcept
+    {
+        m_size += size;
+
+        for(; 0 != size; --size)
+        {
+            m_block[m_block_size++] = static_cast<uint8_t>(*data++);
+
+            if(sizeof(m_block) == m_block_size)
+            {
+                transform();
+            }
+        }
+    }
+
+    void final(uint8_t (&digest)[digest_size])                          noexcept
+    {
+        const uint64_t bits = m_size * 8;
+
+        m_block[m_block_size++] = 0x80;
+
+        if(m_block_size > sizeof(m_block) - 8)
+        {
+            std::memset(m_block + m_block_size, 0, sizeof(m_block) - m_block_size);
+            transform();
+        }
+
+        std::memset(m_block + m_block_size, 0, sizeof(m_block) - 8 - m_block_size);
+
+        for(std::size_t i = 0; i < 8; ++i)
+        {
+            m_block[sizeof(m_block) - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+        }
+
+        transform();
+
+        for(std::size_t i = 0; i < digest_size; ++i)
+        {
+            digest[i] = static_cast<uint8_t>(m_h[i / 4] >> (24 - (i % 4) * 8));
+        }
+    }
+
+private:
+    static uint32_t rol(uint32_t v, unsigned bits)                      noexcept
+    {
+        return (v << bits) | (v >> (32 - bits));
+    }
+
+    void transform()                                                    noexcept
+    {
+        uint32_t w[80];
+
+        for(std::size_t i = 0; i < 16; ++i)
+        {
+            w[i] = (uint32_t(m_block[i * 4])     << 24) |
+                   (uint32_t(m_block[i * 4 + 1]) << 16) |
+                   (uint32_t(m_block[i * 4 + 2]) << 8)  |
+                    uint32_t(m_block[i * 4 + 3]);
+        }
+
+        for(std::size_t i = 16; i < 80; ++i)
+        {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = m_h[0];
+        uint32_t b = m_h[1];
+        uint32_t c = m_h[2];
+        uint32_t d = m_h[3];
+        uint32_t e = m_h[4];
+
+        for(std::size_t i = 0; i < 80; ++i)
+        {
+            uint32_t f = (i < 20) ? ((b & c) | (~b & d)) + 0x5a827999          :
+                         (i < 40) ? (b ^ c ^ d) + 0x6ed9eba1                   :
+                         (i < 60) ? ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc :
+                                    (b ^ c ^ d) + 0xca62c1d6;
+
+            uint32_t t = rol(a, 5) + f + e + w[i];
+
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+
+        m_h[0] += a;
+        m_h[1] += b;
+        m_h[2] += c;
+        m_h[3] += d;
+        m_h[4] += e;
+
+        m_block_size = 0;
+    }
+
+    uint32_t    m_h[5]       { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    uint8_t     m_block[64]  {};
+    std::size_t m_block_size { 0 };
+    uint64_t    m_size       { 0 };
+};
+
+// Output must hold 4 * ((size + 2) / 3) chars and terminator.
+static inline void base64_encode(const uint8_t* data,
+                                 std::size_t    size,
+                                 char*          out)                    noexcept
+{
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for(std::size_t i = 0; i < size; i += 3)
+    {
+        uint32_t v = uint32_t(data[i]) << 16;
+
+        if(i + 1 < size)
+        {
+            v |= uint32_t(data[i + 1]) << 8;
+        }
+
+        if(i + 2 < size)
+        {
+            v |= data[i + 2];
+        }
+
+        *out++ = alphabet[(v >> 18) & 0x3f];
+        *out++ = alphabet[(v >> 12) & 0x3f];
+        *out++ = (i + 1 < size) ? alphabet[(v >> 6) & 0x3f] : '=';
+        *out++ = (i + 2 < size) ? alphabet[v & 0x3f]        : '=';
+    }
+
+    *out = 0;
+}
+
+// Sec-WebSocket-Accept value for Sec-WebSocket-Key.
+static inline void websocket_accept(const char* key, char (&accept)[29])  noexcept
+{
+    static const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    uint8_t digest[sha1::digest_size];
+    sha1    h;
+
+    h.update(key, std::strlen(key));
+    h.update(guid, sizeof(guid) - 1);
+    h.final(digest);
+
+    base64_encode(digest, sizeof(digest), accept);
+}
+
+// Server frames are not masked.
+template<typename ST>
+static void write_ws_frame(ST&         st,
+                           ws_opcode   op,
+                           const char* data,
+                           std::size_t size,
+                           bool        fin = true)                      noexcept
+{
+    uint8_t     header[10];
+    std::size_t length = 0;
+
+    header[length++] = static_cast<uint8_t>((fin ? 0x80 : 0) | static_cast<uint8_t>(op));
+
+    if(size < 126)
+    {
+        header[length++] = static_cast<uint8_t>(size);
+    }
+    else if(size <= 0xffff)
+    {
+        header[length++] = 126;
+        header[length++] = static_cast<uint8_t>(size >> 8);
+        header[length++] = static_cast<uint8_t>(size);
+    }
+    else
+    {
+        header[length++] = 127;
+
+        for(int i = 7; i >= 0; --i)
+        {
+            header[length++] = static_cast<uint8_t>(uint64_t(size) >> (i * 8));
+        }
+    }
+
+    st.write(reinterpret_cast<const char*>(header), length);
+
+    if(0 != size)
+    {
+        st.write(data, size);
+    }
+
+    st.flush();
+}
+
+// Sink of websocket_writer buffer.
+template<typename WRITER>
+struct ws_fragment_sink
+{
+    void write(const char* const buf, std::size_t size)
+    {
+        m_writer->fragment(buf, size);
+    }
+
+    WRITER* m_writer;
+};
+
+// Message, that is serialized with ecl::stream operators to the stream of
+// websocket session. Data, that doesn't fit the buffer, is sent as
+// fragment, end object (or finish()) sends the last one.
+template<std::size_t BUFFER_SIZE, typename ST>
+class websocket_writer
+    : public ecl::stream<BUFFER_SIZE, ws_fragment_sink<websocket_writer<BUFFER_SIZE, ST>>>
+{
+public:
+    using base_t = ecl::stream<BUFFER_SIZE, ws_fragment_sink<websocket_writer>>;
+
+    explicit websocket_writer(ST& st, ws_opcode op = ws_opcode::TEXT)    noexcept
+        : base_t   ( ws_fragment_sink<websocket_writer> { this } )
+        , m_st     ( st )
+        , m_first  ( op )
+        , m_opcode ( op )
+    {}
+
+    // Writer may be used for the next message then.
+    void finish()
+    {
+        m_last = true;
+        base_t::flush();
+
+        // Nothing was buffered, empty frame ends the message.
+        if(m_last)
+        {
+            fragment(nullptr, 0);
+        }
+    }
+
+    websocket_writer& operator<< (const end&)
+    {
+        finish();
+        return *this;
+    }
+
+    template<typename T>
+    websocket_writer& operator<< (const T& val)
+    {
+        base_t::operator<<(val);
+        return *this;
+    }
+
+private:
+    websocket_writer(const websocket_writer& other)                    = delete;
+    websocket_writer& operator= (const websocket_writer& other)        = delete;
+    websocket_writer(const websocket_writer&& other)                   = delete;
+    websocket_writer& operator= (const websocket_writer&& other)       = delete;
+
+    friend ws_fragment_sink<websocket_writer>;
+
+    void fragment(const char* buf, std::size_t size)
+    {
+        const bool fin = m_last;
+
+        write_ws_frame(m_st, m_opcode, buf, size, fin);
+
+        m_last   = false;
+        m_opcode = fin ? m_first : ws_opcode::CONTINUATION;
+    }
+
+    ST&       m_st;
+    ws_opcode m_first;
+    ws_opcode m_opcode;
+    bool      m_last   { false };
+};
+
+// WebSocket endpoint (RFC 6455). GET with Upgrade is answered with
+// handshake and the connection is taken over by one of SESSIONS_COUNT
+// sessions. Messages up to MESSAGE_SIZE bytes are reassembled from
+// fragments and passed to on_message(), pings are answered.
+// Derived resource overrides on_open(), on_message() and on_close() and
+// pushes data with session::send(), websocket_writer or broadcast() at
+// any time, but from the thread, that runs the server.
+// Text messages are not checked for valid UTF-8.
+template
+<
+      typename    ST
+    , std::size_t SESSIONS_COUNT = 4
+    , std::size_t MESSAGE_SIZE   = 512
+>
+class websocket_resource : public i_resource<ST>
+{
+public:
+    class session : public i_session<ST>
+    {
+    public:
+        session()                                                       noexcept
+        {}
+
+        virtual ~session()                                     noexcept override
+        {}
+
+        bool is_open()                                            const noexcept
+        {
+            return nullptr != m_stream;
+        }
+
+        // Stream of the connection, e.g. for websocket_writer.
+        ST& stream()                                                    noexcept
+        {
+            return *m_stream;
+        }
+
+        // Nothing is sent after close frame.
+        void send(ws_opcode op, const char* data, std::size_t size)     noexcept
+        {
+            if(is_open() && !m_close_sent)
+            {
+                write_ws_frame(*m_stream, op, data, size);
+            }
+        }
+
+        void send_text(const char* text)                                noexcept
+        {
+            send(ws_opcode::TEXT, text, std::strlen(text));
+        }
+
+        // Connection is closed, when client answers with close frame.
+        void close(ws_close code = ws_close::NORMAL)                    noexcept
+        {
+            const char status[2] =
+            {
+                  static_cast<char>(static_cast<uint16_t>(code) >> 8)
+                , static_cast<char>(static_cast<uint16_t>(code) & 0xff)
+            };
+
+            send(ws_opcode::CLOSE, status, sizeof(status));
+            m_close_sent = true;
+        }
+
+        // Frames are decoded in place as they arrive, payload is unmasked
+        // to the message buffer (control frames to their own buffer, as
+        // they may come between fragments of a message).
+        virtual bool on_data(ST&         st,
+                             const char* buf,
+                             std::size_t size)                 noexcept override
+        {
+            while(0 != size)
+            {
+                if(m_header_size < m_header_need)
+                {
+                    std::size_t n = m_header_need - m_header_size;
+                    n = (n < size) ? n : size;
+
+                    std::memcpy(m_header + m_header_size, buf, n);
+                    m_header_size += n;
+                    buf           += n;
+                    size          -= n;
+
+                    if((m_header_size == m_header_need) && !on_header(st))
+                    {
+                        return false;
+                    }
+
+                    continue;
+                }
+
+                std::size_t n = (m_left < size) ? m_left : size;
+
+                for(std::size_t i = 0; i < n; ++i)
+                {
+                    *m_target++ = static_cast<char>(buf[i] ^ m_header[m_header_size - 4 + (m_mask_pos++ & 3)]);
+                }
+
+                m_left -= n;
+                buf    += n;
+                size   -= n;
+
+                if((0 == m_left) && !on_frame(st))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        virtual void on_close(ST&)                             noexcept override
+        {
+            m_owner->on_close(*this);
+            m_stream = nullptr;
+        }
+
+    private:
+        session(const session& other)                                  = delete;
+        session& operator= (const session& other)                      = delete;
+        session(const session&& other)                                 = delete;
+        session& operator= (const session&& other)                     = delete;
+
+        friend websocket_resource;
+
+        void open(websocket_resource* owner, ST& st)                    noexcept
+        {
+            m_owner        = owner;
+            m_stream       = &st;
+            m_header_size  = 0;
+            m_header_need  = 2;
+            m_message_size = 0;
+            m_in_message   = false;
+            m_close_sent   = false;
+        }
+
+        bool fail(ws_close code)                                        noexcept
+        {
+            close(code);
+            return false;
+        }
+
+        // First two bytes tell size of the rest of the header.
+        bool on_header(ST& st)                                          noexcept
+        {
+            const uint8_t* h   = reinterpret_cast<const uint8_t*>(m_header);
+            const uint8_t  len = h[1] & 0x7f;
+
+            if(2 == m_header_size)
+            {
+                // Client frames must be masked.
+                if(0 == (h[1] & 0x80))
+                {
+                    return fail(ws_close::PROTOCOL_ERROR);
+                }
+
+                m_header_need = 2 + ((126 == len) ? 2 : (127 == len) ? 8 : 0) + 4;
+                return true;
+            }
+
+            uint64_t size = len;
+
+            if(len >= 126)
+            {
+                size = 0;
+
+                for(std::size_t i = 2; i < m_header_size - 4; ++i)
+                {
+                    size = (size << 8) | h[i];
+                }
+            }
+
+            m_fin    = 0 != (h[0] & 0x80);
+            m_opcode = static_cast<ws_opcode>(h[0] & 0x0f);
+
+            if(0 != (h[0] & 0x70))
+            {
+                return fail(ws_close::PROTOCOL_ERROR);
+            }
+
+            switch(m_opcode)
+            {
+                case ws_opcode::CLOSE:
+                case ws_opcode::PING:
+                case ws_opcode::PONG:
+                    if(!m_fin || (size > sizeof(m_control)))
+                    {
+                        return fail(ws_close::PROTOCOL_ERROR);
+                    }
+
+                    m_target = m_control;
+                break;
+                case ws_opcode::TEXT:
+                case ws_opcode::BINARY:
+                case ws_opcode::CONTINUATION:
+                    if((ws_opcode::CONTINUATION == m_opcode) == !m_in_message)
+                    {
+                        return fail(ws_close::PROTOCOL_ERROR);
+                    }
+
+                    if(size > MESSAGE_SIZE - m_message_size)
+                    {
+                        return fail(ws_close::MESSAGE_TOO_BIG);
+                    }
+
+                    if(!m_in_message)
+                    {
+                        m_in_message      = true;
+                        m_message_opcode  = m_opcode;
+                    }
+
+                    m_target = m_message + m_message_size;
+                break;
+                default:
+                    return fail(ws_close::PROTOCOL_ERROR);
+            }
+
+            m_frame    = m_target;
+            m_left     = static_cast<std::size_t>(size);
+            m_mask_pos = 0;
+
+            return (0 != m_left) || on_frame(st);
+        }
+
+        bool on_frame(ST& st)                                           noexcept
+        {
+            const std::size_t size = m_target - m_frame;
+
+            m_header_size = 0;
+            m_header_need = 2;
+
+            switch(m_opcode)
+            {
+                case ws_opcode::PING:
+                    write_ws_frame(st, ws_opcode::PONG, m_control, size);
+                return true;
+                case ws_opcode::PONG:
+                return true;
+                case ws_opcode::CLOSE:
+                    // Status code of the client is echoed, unless it is
+                    // the answer to our close frame.
+                    if(!m_close_sent)
+                    {
+                        write_ws_frame(st, ws_opcode::CLOSE, m_control, (size < 2) ? size : 2);
+                        m_close_sent = true;
+                    }
+                return false;
+                default:
+                break;
+            }
+
+            m_message_size += size;
+
+            if(m_fin)
+            {
+                m_in_message = false;
+                m_owner->on_message(*this, m_message_opcode, m_message, m_message_size);
+                m_message_size = 0;
+            }
+
+            return true;
+        }
+
+        websocket_resource* m_owner                 { nullptr };
+        ST*                 m_stream                { nullptr };
+        bool                m_close_sent            { false };
+
+        char                m_header[14]            {};
+        std::size_t         m_header_size           { 0 };
+        std::size_t         m_header_need           { 2 };
+
+        ws_opcode           m_opcode                { ws_opcode::CONTINUATION };
+        bool                m_fin                   { false };
+        char*               m_frame                 { nullptr };
+        char*               m_target                { nullptr };
+        std::size_t         m_left                  { 0 };
+        std::size_t         m_mask_pos              { 0 };
+
+        char                m_control[125]          {};
+
+        ws_opcode           m_message_opcode        { ws_opcode::TEXT };
+        bool                m_in_message            { false };
+        std::size_t         m_message_size          { 0 };
+        char                m_message[MESSAGE_SIZE] {};
+    };
+
+    websocket_resource()                                                noexcept
+    {}
+
+    virtual ~websocket_resource()                              noexcept override
+    {}
+
+    virtual status_code on_request(ST&              st,
+                                   i_request_cache& cache)     noexcept override
+    {
+        if(method::GET != cache.get_met())
+        {
+            return status_code::METHOD_NOT_ALLOWED;
+        }
+
+        header_value_t upgrade = cache.get_hdr(header_name::UPGRADE);
+        header_value_t conn    = cache.get_hdr(header_name::CONNECTION);
+        header_value_t key     = cache.get_hdr(header_name::SEC_WEBSOCKET_KEY);
+        header_value_t ver     = cache.get_hdr(header_name::SEC_WEBSOCKET_VERSION);
+
+        // RFC 6455 4.2.1: Connection lists Upgrade, maybe among other tokens.
+        if((nullptr == upgrade) || (0 != header_name_cmp(upgrade, "websocket")) ||
+           !has_header_token(conn, "upgrade")                                  ||
+           (nullptr == key)     || (nullptr == ver) || (0 != std::strcmp(ver, "13")))
+        {
+            return status_code::BAD_REQUEST;
+        }
+
+        m_pending = nullptr;
+
+        for(auto& s : m_sessions)
+        {
+            if(!s.is_open())
+            {
+                m_pending = &s;
+                break;
+            }
+        }
+
+        if(nullptr == m_pending)
+        {
+            return status_code::SERVICE_UNAVAILABLE;
+        }
+
+        char accept[29];
+        websocket_accept(key, accept);
+
+        write_status_line(st, cache.get_ver(), status_code::SWITCHING_PROTO);
+        st << to_string(header_name::UPGRADE)              << ":websocket\r\n"
+           << to_string(header_name::CONNECTION)           << ":Upgrade\r\n"
+           << to_string(header_name::SEC_WEBSOCKET_ACCEPT) << ":" << accept << "\r\n"
+           << "\r\n";
+
+        st.flush();
+
+        return status_code::OK;
+    }
+
+    // Session, reserved by handshake, takes the connection.
+    virtual i_session<ST>* open_session(ST& st, i_request_cache&)       noexcept override
+    {
+        session* s = m_pending;
+        m_pending = nullptr;
+
+        if(nullptr != s)
+        {
+            s->open(this, st);
+            on_open(*s);
+        }
+
+        return s;
+    }
+
+    // Message is sent to all open sessions.
+    void broadcast(ws_opcode op, const char* data, std::size_t size)    noexcept
+    {
+        for(auto& s : m_sessions)
+        {
+            s.send(op, data, size);
+        }
+    }
+
+protected:
+    virtual void on_open(session&)                                      noexcept
+    {}
+
+    virtual void on_message(session&, ws_opcode, const char*, std::size_t) noexcept
+    {}
+
+    virtual void on_close(session&)                                     noexcept
+    {}
+
+private:
+    websocket_resource(const websocket_resource& other)                = delete;
+    websocket_resource& operator= (const websocket_resource& other)    = delete;
+    websocket_resource(const websocket_resource&& other)               = delete;
+    websocket_resource& operator= (const websocket_resource&& other)   = delete;
+
+    session  m_sessions[SESSIONS_COUNT] {};
+    session* m_pending                  { nullptr };
+};
+
+} // namespace web
+
+} // namespace ecl
+
+#endif // ECL_WEB_WEBSOCKET_HPP
@@ -4,12 +4,13 @@ if [ $# -lt 2 ] ; then
     echo "Usage: ./res_gen.sh RES_FILE OUT_DIR [-c]";
     echo "RES_FILE : Resource file to encode."
     echo "OUT_DIR  : Output directory, where encoded file will be saved."
-    echo "-c       : true Compress with gzip resource file."
+    echo "-c       : Add gzip (and brotli, if installed) compressed variants."
     exit 1
 fi
 
 XXD=xxd
 command -v $XXD >/dev/null 2>&1 || { echo "$XXD command not found."; exit 1; }
+command -v md5sum >/dev/null 2>&1 || { echo "md5sum command not found."; exit 1; }
 
 BASE=$(dirname $0)
 HEADER_EXT=h
@@ -33,12 +34,82 @@ if [ ! -d $OUT_DIR ]; then
     mkdir -p $OUT_DIR
 fi
 
+case $RES_NAME in
+    *.html|*.htm) CONTENT_TYPE="text/html"              ;;
+    *.css)        CONTENT_TYPE="text/css"               ;;
+    *.js)         CONTENT_TYPE="text/javascript"        ;;
+    *.json)       CONTENT_TYPE="application/json"       ;;
+    *.png)        CONTENT_TYPE="image/png"              ;;
+    *.jpg|*.jpeg) CONTENT_TYPE="image/jpeg"             ;;
+    *.gif)        CONTENT_TYPE="image/gif"              ;;
+    *.ico)        CONTENT_TYPE="image/x-icon"           ;;
+    *.svg)        CONTENT_TYPE="image/svg+xml"          ;;
+    *)            CONTENT_TYPE="text/plain"             ;;
+esac
+
+# Identity variant is always generated. With -c gzip variant and, if brotli
+# is installed, br variant are generated too: server sends the smallest one,
+# that client accepts.
+VARIANTS="identity"
 if [ "$3" = "-c" ]; then
     echo "Compressing file with gzip.";
-    gzip -c --best $RES_FILE > $RES_FILE.gz
-    RES_FILE=$RES_FILE.gz
+    gzip -c -n --best $RES_FILE > $OUT_DIR/$RES_NAME_PROG.gzip
+    VARIANTS="$VARIANTS gzip"
+
+    if command -v brotli >/dev/null 2>&1 ; then
+        echo "Compressing file with brotli.";
+        brotli -c --best $RES_FILE > $OUT_DIR/$RES_NAME_PROG.br
+        VARIANTS="$VARIANTS br"
+    fi
 fi
 
+# Entity headers are fixed for variant, so they are rendered here
+# and stored right before data: static response is one contiguous block.
+# Content-Length opens the block, 206 response sends the rest after own
+# Content-Range and Content-Length. Validator and cache headers close the
+# block, 304 response repeats them.
+# Usage: gen_variant ENCODING DATA_FILE INDENT
+gen_variant()
+{
+    DATA_SIZE=$(wc -c < $2 | tr -d ' ')
+    ETAG=$(md5sum $2 | cut -c 1-16)
+
+    RESPONSE_FILE=$OUT_DIR/$RES_NAME_PROG.response
+    printf "Content-Length:%s\r\n" "$DATA_SIZE"                               >  $RESPONSE_FILE
+    LENGTH_SIZE=$(wc -c < $RESPONSE_FILE | tr -d ' ')
+    printf "Content-Type:%s\r\n" "$CONTENT_TYPE"                              >> $RESPONSE_FILE
+    if [ "$1" != "identity" ]; then
+        printf "Content-Encoding:%s\r\n" "$1"                                 >> $RESPONSE_FILE
+    fi
+    printf "Accept-Ranges:bytes\r\n"                                          >> $RESPONSE_FILE
+    VALIDATORS_OFFSET=$(wc -c < $RESPONSE_FILE | tr -d ' ')
+    printf "ETag:\"%s\"\r\n" "$ETAG"                                          >> $RESPONSE_FILE
+    if [ "$VARIANTS" != "identity" ]; then
+        printf "Vary:Accept-Encoding\r\n"                                     >> $RESPONSE_FILE
+    fi
+    printf "Cache-Control:no-cache\r\n"                                       >> $RESPONSE_FILE
+    printf "\r\n"                                                             >> $RESPONSE_FILE
+    HEADERS_SIZE=$(wc -c < $RESPONSE_FILE | tr -d ' ')
+    cat $2                                                                    >> $RESPONSE_FILE
+    RESPONSE_SIZE=$(wc -c < $RESPONSE_FILE | tr -d ' ')
+
+    echo "$3// Entity headers followed by data."
+    echo "${3}static constexpr unsigned char response[] = {"
+    $XXD -i < $RESPONSE_FILE | sed "s/^  /$3    /"
+    echo "$3};"
+    echo "${3}static constexpr size_t response_size = $RESPONSE_SIZE;"
+    echo "${3}static constexpr size_t headers_size = $HEADERS_SIZE;"
+    echo "${3}static constexpr size_t length_size = $LENGTH_SIZE;"
+    echo "${3}static constexpr size_t validators_offset = $VALIDATORS_OFFSET;"
+    echo ""
+    echo "${3}static constexpr const unsigned char* data = response + headers_size;"
+    echo "${3}static constexpr size_t size = $DATA_SIZE;"
+    echo ""
+    echo "${3}static constexpr char etag[] = \"\\\"$ETAG\\\"\";"
+
+    rm $RESPONSE_FILE
+}
+
 HEADER_NAME=$RES_NAME_PROG.h
 HEADER_FILE=$OUT_DIR/$HEADER_NAME
 
@@ -59,18 +130,19 @@ echo "{"
 echo ""                                                                             >> $HEADER_FILE
 echo "using ${STRUCT_NAME_TPD} = struct ${STRUCT_NAME}"                             >> $HEADER_FILE
 echo "{"                                                                            >> $HEADER_FILE
-echo -n "    static constexpr "                                                     >> $HEADER_FILE
-$XXD -i $RES_FILE | sed 's/[a-z_0-9]*_len/size/' | sed 's/[a-z_0-9]*\[\]/data\[\]/' >> $HEADER_FILE
-sed -i -e 's/  0x/        0x/'                                                         $HEADER_FILE
-sed -i -e 's/};/    };/'                                                               $HEADER_FILE
-sed -i -e 's/unsigned int/\n    static constexpr size_t/'                              $HEADER_FILE
+echo "    // Same for all variants, static_resource reports it as content type."    >> $HEADER_FILE
+echo "    static constexpr char mime_type[] = \"$CONTENT_TYPE\";"                       >> $HEADER_FILE
 echo ""                                                                             >> $HEADER_FILE
-echo -n "    static constexpr bool compressed = "                                   >> $HEADER_FILE
-if [ "$3" = "-c" ]; then
-    echo "true;"                                                                    >> $HEADER_FILE
-else
-    echo "false;"                                                                   >> $HEADER_FILE
-fi
+gen_variant identity $RES_FILE "    "                                              >> $HEADER_FILE
+for VARIANT in $VARIANTS ; do
+    if [ "$VARIANT" != "identity" ]; then
+        echo ""                                                                     >> $HEADER_FILE
+        echo "    struct ${VARIANT}"                                                >> $HEADER_FILE
+        echo "    {"                                                                >> $HEADER_FILE
+        gen_variant $VARIANT $OUT_DIR/$RES_NAME_PROG.$VARIANT "        "            >> $HEADER_FILE
+        echo "    };"                                                               >> $HEADER_FILE
+    fi
+done
 echo "};"                                                                           >> $HEADER_FILE
 echo ""                                                                             >> $HEADER_FILE
 echo "} // namespace ${NAMESPACE_NAME}"                                             >> $HEADER_FILE
@@ -79,15 +151,24 @@ echo "#endif // $HEADER_GUARD_DEF"
 
 echo " * $HEADER_FILE generated"
 
-echo "#include \"$HEADER_NAME\""                                              >  $SOURCE_FILE
-echo ""                                                                       >> $SOURCE_FILE
-echo "constexpr unsigned char ${NAMESPACE_NAME}::${STRUCT_NAME_TPD}::data[];" >> $SOURCE_FILE
+echo "#include \"$HEADER_NAME\""                                                  >  $SOURCE_FILE
+echo ""                                                                             >> $SOURCE_FILE
+echo "constexpr unsigned char ${NAMESPACE_NAME}::${STRUCT_NAME_TPD}::response[];"   >> $SOURCE_FILE
+echo "constexpr const unsigned char* ${NAMESPACE_NAME}::${STRUCT_NAME_TPD}::data;"  >> $SOURCE_FILE
+echo "constexpr char ${NAMESPACE_NAME}::${STRUCT_NAME_TPD}::mime_type[];"           >> $SOURCE_FILE
+echo "constexpr char ${NAMESPACE_NAME}::${STRUCT_NAME_TPD}::etag[];"                >> $SOURCE_FILE
+for VARIANT in $VARIANTS ; do
+    if [ "$VARIANT" != "identity" ]; then
+        STRUCT_VARIANT=${NAMESPACE_NAME}::${STRUCT_NAME_TPD}::${VARIANT}
+        echo "constexpr unsigned char ${STRUCT_VARIANT}::response[];"              >> $SOURCE_FILE
+        echo "constexpr const unsigned char* ${STRUCT_VARIANT}::data;"             >> $SOURCE_FILE
+        echo "constexpr char ${STRUCT_VARIANT}::etag[];"                           >> $SOURCE_FILE
+        rm $OUT_DIR/$RES_NAME_PROG.$VARIANT
+    fi
+done
 
 echo " * $SOURCE_FILE generated"
 
-if [ "$3" = "-c" ]; then
-    rm $RES_FILE
-fi
 
 # echo -n "extern constexpr " > $HEADER_DIR/$HEADER_NAME
 # cd $RES_DIR
@@ -0,0 +1,2150 @@
+#ifndef ECL_TEST_WEB_HPP
+#define ECL_TEST_WEB_HPP
+
+#include <ecl/web.hpp>
+#include <ecl/web/event_loop.hpp>
+#include <ecl/web/file_resource.hpp>
+#include <ecl/web/server_shards.hpp>
+#include <ecl/name_type.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+BOOST_AUTO_TEST_SUITE( web_suite )
+
+using server_t = ecl::web::server<512, 128, 8, 8, 8, 2>;
+
+struct text_resource : public server_t::i_resource_t
+{
+    virtual ~text_resource()                                   noexcept override
+    {}
+
+    virtual ecl::web::status_code on_request(
+            server_t::stream_t&        st,
+            ecl::web::i_request_cache& c
+        )                                                      noexcept override
+    {
+        ++m_calls;
+
+        m_met  = c.get_met();
+        m_body = c.get_body().first ? c.get_body().first : "";
+
+        ecl::web::header_value_t trailer = c.get_hdr("X-Trailer");
+        m_trailer = trailer ? trailer : "";
+
+        ecl::web::header_value_t host = c.get_hdr(ecl::web::header_name::HOST);
+        m_host = host ? host : "";
+
+        ecl::web::header_value_t type = c.get_hdr(ecl::web::header_name::CONTENT_TYPE);
+        m_type = type ? type : "";
+
+        ecl::web::header_value_t empty = c.get_hdr("X-Empty");
+        m_empty = empty ? empty : "<none>";
+
+        ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+        st << "\r\n" << "text";
+        st.flush();
+
+        return ecl::web::status_code::OK;
+    }
+
+    std::size_t           m_calls   { 0 };
+    ecl::web::method      m_met     { ecl::web::method::GET };
+    std::string           m_body    {};
+    std::string           m_trailer {};
+    std::string           m_host    {};
+    std::string           m_type    {};
+    std::string           m_empty   {};
+};
+
+struct web_fixture
+{
+    web_fixture()
+        : srv()
+        , res()
+        , out_1()
+        , out_2()
+    {
+        BOOST_TEST_MESSAGE( "setup web_fixture" );
+
+        srv.attach_resource("/text", res);
+    }
+
+    ~web_fixture()
+    {
+        BOOST_TEST_MESSAGE( "teardown web_fixture" );
+    }
+
+    ecl::web::send_callback_t sink(std::string& out)
+    {
+        return [&out](const char* const buf, std::size_t size)
+        {
+            out.append(buf, size);
+        };
+    }
+
+    server_t      srv;
+    text_resource res;
+    std::string   out_1;
+    std::string   out_2;
+};
+
+#define WEB_TEST_GET_TEXT "GET /text HTTP/1.1\r\nHost: localhost\r\n\r\n"
+
+BOOST_FIXTURE_TEST_CASE( connection_pool_case, web_fixture )
+{
+    server_t::connection_t* c_1 = srv.open(sink(out_1));
+    server_t::connection_t* c_2 = srv.open(sink(out_2));
+
+    BOOST_REQUIRE(nullptr != c_1);
+    BOOST_REQUIRE(nullptr != c_2);
+    BOOST_CHECK(nullptr == srv.open(sink(out_1)));
+
+    std::string rq(WEB_TEST_GET_TEXT);
+    c_1->process_request(rq.data(), rq.size());
+    c_2->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(0 == out_2.find("HTTP/1.1 200"));
+    BOOST_CHECK(2 == res.m_calls);
+
+    srv.close(c_1);
+    BOOST_CHECK(c_1 == srv.open(sink(out_1)));
+}
+
+BOOST_FIXTURE_TEST_CASE( not_found_case, web_fixture )
+{
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /missing HTTP/1.1\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 404"));
+    BOOST_CHECK(0 == res.m_calls);
+
+    // Error reply has version of the request.
+    srv.close(c);
+    out_1.clear();
+    c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    rq = "GET /missing HTTP/1.0\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.0 404"));
+
+    srv.close(c);
+    c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    // Path close to the cache size is looked up too.
+    out_1.clear();
+    rq = "GET /" + std::string(480, 'x') + " HTTP/1.1\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 404"));
+    BOOST_CHECK(0 == res.m_calls);
+}
+
+BOOST_FIXTURE_TEST_CASE( fragmented_request_case, web_fixture )
+{
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("POST /text HTTP/1.1\r\nHost: localhost\r\n"
+                   "Content-Length: 11\r\n\r\nhello world");
+
+    for(std::size_t i = 0; i < rq.size(); i += 3)
+    {
+        BOOST_CHECK(0 == res.m_calls);
+        c->process_request(rq.data() + i, std::min<std::size_t>(3, rq.size() - i));
+    }
+
+    BOOST_CHECK(1 == res.m_calls);
+    BOOST_CHECK(ecl::web::method::POST == res.m_met);
+    BOOST_CHECK_MESSAGE(res.m_body == "hello world", res.m_body);
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+}
+
+BOOST_FIXTURE_TEST_CASE( chunked_request_case, web_fixture )
+{
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("POST /text HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                   "5\r\nhello\r\n"
+                   "1\r\n \r\n"
+                   "5;ext=1\r\nworld\r\n"
+                   "0\r\nX-Trailer: 1\r\n\r\n"
+                   "GET /text HTTP/1.1\r\n\r\n");
+
+    std::size_t split = 60;
+    c->process_request(rq.data(), split);
+    c->process_request(rq.data() + split, rq.size() - split);
+
+    BOOST_CHECK(2 == res.m_calls);
+    BOOST_CHECK(ecl::web::method::GET == res.m_met);
+
+    res.m_calls = 0;
+    c->process_request(rq.data(), rq.size() - 22);
+
+    BOOST_CHECK(1 == res.m_calls);
+    BOOST_CHECK_MESSAGE(res.m_body == "hello world", res.m_body);
+    BOOST_CHECK("1" == res.m_trailer);
+}
+
+BOOST_FIXTURE_TEST_CASE( empty_header_value_case, web_fixture )
+{
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq_1("GET /text HTTP/1.1\r\nX-Empty:\r\nHost: example\r\n\r\n");
+    c->process_request(rq_1.data(), rq_1.size());
+
+    BOOST_CHECK(1 == res.m_calls);
+    BOOST_CHECK_MESSAGE(res.m_host == "example", res.m_host);
+    BOOST_CHECK(res.m_empty.empty());
+
+    std::string rq_2("POST /text HTTP/1.1\r\nX-Empty: \r\n"
+                     "Content-Type: text/plain\r\nContent-Length: 1\r\n\r\nx");
+    c->process_request(rq_2.data(), rq_2.size());
+
+    BOOST_CHECK(2 == res.m_calls);
+    BOOST_CHECK_MESSAGE(res.m_type == "text/plain", res.m_type);
+    BOOST_CHECK(res.m_empty.empty());
+    BOOST_CHECK(res.m_body == "x");
+}
+
+BOOST_FIXTURE_TEST_CASE( too_large_request_case, web_fixture )
+{
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /text HTTP/1.1\r\nX-Fill: ");
+    rq.append(1024, 'x');
+
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == res.m_calls);
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 413"));
+}
+
+BOOST_FIXTURE_TEST_CASE( pipelined_requests_case, web_fixture )
+{
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("POST /text HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+                   "GET /text HTTP/1.1\r\n\r\n"
+                   "GET /text HTTP/1.1\r\nConnection: close\r\n\r\n"
+                   "GET /text HTTP/1.1\r\n\r\n");
+
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(3 == res.m_calls);
+    BOOST_CHECK(ecl::web::method::GET == res.m_met);
+    BOOST_CHECK(!c->is_keep_alive());
+}
+
+BOOST_FIXTURE_TEST_CASE( request_limits_case, web_fixture )
+{
+    srv.set_limits({ 2, 64, 10, 16, 3, 5 });
+
+    auto request = [this](const std::string& rq)
+    {
+        server_t::connection_t* c = srv.open(sink(out_1));
+
+        out_1.clear();
+        c->process_request(rq.data(), rq.size());
+        srv.close(c);
+
+        return out_1.substr(0, 12);
+    };
+
+    BOOST_CHECK("HTTP/1.1 200" == request("GET /text HTTP/1.1\r\nA: 1\r\nB: 2\r\n\r\n"));
+    BOOST_CHECK("HTTP/1.1 414" == request("GET /text?longer HTTP/1.1\r\n\r\n"));
+    BOOST_CHECK("HTTP/1.1 431" == request("GET /text HTTP/1.1\r\nA: 1\r\nB: 2\r\nC: 3\r\n\r\n"));
+    BOOST_CHECK("HTTP/1.1 431" == request("GET /text HTTP/1.1\r\nA: " + std::string(64, 'a') + "\r\n\r\n"));
+    BOOST_CHECK("HTTP/1.1 413" == request("POST /text HTTP/1.1\r\nContent-Length: 17\r\n\r\n"));
+    BOOST_CHECK("HTTP/1.1 413" == request("POST /text HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                          "10\r\n0123456789abcdef\r\n1\r\nx\r\n0\r\n\r\n"));
+    BOOST_CHECK(1 == res.m_calls);
+
+    // Slow request runs out of time, even if data keeps coming.
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    out_1.clear();
+    std::string rq("GET /text HTTP/1.1\r\n");
+    for(std::size_t i = 0; i < 3; ++i)
+    {
+        c->process_request(rq.data() + i, 1);
+        BOOST_CHECK(c->tick());
+    }
+
+    srv.tick();
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 408"));
+    BOOST_CHECK(!c->is_keep_alive());
+
+    // Idle connection is closed silently.
+    c->restart();
+    out_1.clear();
+
+    for(std::size_t i = 0; i < 5; ++i)
+    {
+        BOOST_CHECK(c->tick());
+    }
+
+    BOOST_CHECK(!c->tick());
+    BOOST_CHECK(out_1.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE( keep_alive_case, web_fixture )
+{
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq_11("GET /text HTTP/1.1\r\n\r\n");
+    c->process_request(rq_11.data(), rq_11.size());
+    BOOST_CHECK(c->is_keep_alive());
+
+    std::string rq_10("GET /missing HTTP/1.0\r\n\r\n");
+    c->process_request(rq_10.data(), rq_10.size());
+    BOOST_CHECK(!c->is_keep_alive());
+    BOOST_CHECK(std::string::npos != out_1.find("Connection:close"));
+}
+
+#define WEB_TEST_BINARY_HEADERS "Content-Length:200\r\nContent-Type:image/png\r\n" \
+                                "ETag:\"0123\"\r\nCache-Control:no-cache\r\n\r\n"
+
+struct binary_data
+{
+    static constexpr char mime_type[] = "image/png";
+
+    static constexpr unsigned char response[283] = {
+        'C', 'o', 'n', 't', 'e', 'n', 't', '-', 'L', 'e', 'n', 'g', 't', 'h', ':',
+        '2', '0', '0', '\r', '\n',
+        'C', 'o', 'n', 't', 'e', 'n', 't', '-', 'T', 'y', 'p', 'e', ':',
+        'i', 'm', 'a', 'g', 'e', '/', 'p', 'n', 'g', '\r', '\n',
+        'E', 'T', 'a', 'g', ':', '"', '0', '1', '2', '3', '"', '\r', '\n',
+        'C', 'a', 'c', 'h', 'e', '-', 'C', 'o', 'n', 't', 'r', 'o', 'l', ':',
+        'n', 'o', '-', 'c', 'a', 'c', 'h', 'e', '\r', '\n', '\r', '\n',
+        0x01, 0x00, 0x02, 0x00, 0x03
+    };
+    static constexpr std::size_t response_size     = 283;
+    static constexpr std::size_t headers_size      = 83;
+    static constexpr std::size_t length_size       = 20;
+    static constexpr std::size_t validators_offset = 44;
+
+    static constexpr const unsigned char* data = response + headers_size;
+    static constexpr std::size_t          size = 200;
+
+    static constexpr char etag[] = "\"0123\"";
+};
+
+constexpr char          binary_data::mime_type[];
+constexpr unsigned char binary_data::response[];
+constexpr char          binary_data::etag[];
+
+BOOST_FIXTURE_TEST_CASE( static_resource_case, web_fixture )
+{
+    server_t::static_resource_t<binary_data> bin;
+    srv.attach_resource("/bin", bin);
+
+    std::size_t blocks = 0;
+    server_t::connection_t* c = srv.open([this, &blocks](const char* const buf, std::size_t size)
+    {
+        out_1.append(buf, size);
+        ++blocks;
+    });
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /bin HTTP/1.1\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    std::string body(reinterpret_cast<const char*>(binary_data::data), binary_data::size);
+
+    BOOST_REQUIRE(sizeof(binary_data::response) == binary_data::response_size);
+    BOOST_REQUIRE(sizeof(WEB_TEST_BINARY_HEADERS) - 1 == binary_data::headers_size);
+
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Length:200\r\n"));
+    BOOST_CHECK(out_1.size() > body.size());
+    BOOST_CHECK(out_1.substr(out_1.size() - body.size()) == body);
+    // Headers from the stream buffer and data passed directly.
+    BOOST_CHECK(2 == blocks);
+
+    // Former constructor still builds, rendered content type is kept.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+    server_t::static_resource_t<binary_data> old_bin(ecl::web::content_type::TEXT_HTML,
+                                                     ecl::web::status_code::NOT_FOUND);
+#pragma GCC diagnostic pop
+
+    BOOST_CHECK(bin.get_content_type() == old_bin.get_content_type());
+    BOOST_CHECK(ecl::web::status_code::NOT_FOUND == old_bin.get_status_code());
+}
+
+BOOST_FIXTURE_TEST_CASE( not_modified_case, web_fixture )
+{
+    server_t::static_resource_t<binary_data> bin;
+    srv.attach_resource("/bin", bin);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /bin HTTP/1.1\r\nif-none-match: \"abc\", W/\"0123\"\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 304"));
+    BOOST_CHECK(std::string::npos != out_1.find("ETag:\"0123\"\r\n"));
+    BOOST_CHECK(std::string::npos != out_1.find("Cache-Control:no-cache\r\n"));
+    BOOST_CHECK(std::string::npos == out_1.find("Content-Length"));
+    BOOST_CHECK(std::string::npos == out_1.find("Content-Type"));
+
+    out_1.clear();
+    rq = "GET /bin HTTP/1.1\r\nIf-None-Match: \"abc\"\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+}
+
+struct chunked_resource : public server_t::i_resource_t
+{
+    virtual ~chunked_resource()                                noexcept override
+    {}
+
+    virtual ecl::web::status_code on_request(
+            server_t::stream_t&        st,
+            ecl::web::i_request_cache& c
+        )                                                      noexcept override
+    {
+        ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+        ecl::web::set_chunked_header(st);
+        st << "\r\n";
+
+        st.begin_chunked();
+
+        for(std::size_t i = 0; i < 100; ++i)
+        {
+            st << "0123456789";
+        }
+
+        st << ecl::end();
+
+        return ecl::web::status_code::OK;
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE( chunked_response_case, web_fixture )
+{
+    chunked_resource chunked;
+    srv.attach_resource("/chunked", chunked);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /chunked HTTP/1.1\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    std::size_t pos = out_1.find("\r\n\r\n");
+    BOOST_REQUIRE(std::string::npos != pos);
+    pos += 4;
+
+    std::string body;
+    std::size_t chunks = 0;
+
+    while(true)
+    {
+        std::size_t eol = out_1.find("\r\n", pos);
+        BOOST_REQUIRE(std::string::npos != eol);
+
+        std::size_t size = std::stoul(out_1.substr(pos, eol - pos), nullptr, 16);
+        pos = eol + 2;
+
+        if(0 == size)
+        {
+            break;
+        }
+
+        body += out_1.substr(pos, size);
+        pos += size;
+
+        BOOST_REQUIRE(out_1.substr(pos, 2) == "\r\n");
+        pos += 2;
+        ++chunks;
+    }
+
+    BOOST_CHECK(1000 == body.size());
+    BOOST_CHECK(chunks > 1);
+    BOOST_CHECK(out_1.substr(pos) == "\r\n");
+    BOOST_CHECK(c->is_keep_alive());
+}
+
+BOOST_AUTO_TEST_CASE( known_headers_case )
+{
+    using ecl::web::header_name;
+
+    static_assert(ecl::web::header_name_equal("HOST", 4, "Host"), "matcher");
+    static_assert(!ecl::web::header_name_equal("Hostname", 4, "Hosts"), "matcher");
+
+    BOOST_CHECK(header_name::IF_NONE_MATCH == ecl::web::to_header_name("if-none-match", 13));
+    BOOST_CHECK(header_name::HOST == ecl::web::to_header_name("Host: x", 4));
+    BOOST_CHECK(header_name::UNKNOWN == ecl::web::to_header_name("X-Host", 6));
+
+    ecl::web::request_cache<64, 1> c;
+
+    c.set_hdr(header_name::HOST, std::make_pair("Host", "localhost"));
+    c.set_hdr(std::make_pair("accept-encoding", "gzip"));
+    c.set_hdr(std::make_pair("X-First", "1"));
+    c.set_hdr(std::make_pair("X-Second", "2"));
+
+    BOOST_CHECK(0 == std::strcmp("localhost", c.get_hdr("HOST")));
+    BOOST_CHECK(0 == std::strcmp("gzip", c.get_hdr(header_name::ACCEPT_ENCODING)));
+    BOOST_CHECK(0 == std::strcmp("1", c.get_hdr("x-first")));
+    BOOST_CHECK(nullptr == c.get_hdr("X-Second"));
+    BOOST_CHECK(nullptr == c.get_hdr(header_name::RANGE));
+
+    c.clear();
+    BOOST_CHECK(nullptr == c.get_hdr(header_name::HOST));
+    BOOST_CHECK(nullptr == c.get_hdr("X-First"));
+
+    // Unknown headers are skipped.
+    ecl::web::request_cache<64, 0> known_only;
+
+    known_only.set_hdr(std::make_pair("X-First", "1"));
+    known_only.set_hdr(std::make_pair("Range", "bytes=0-1"));
+
+    BOOST_CHECK(nullptr == known_only.get_hdr("X-First"));
+    BOOST_CHECK(nullptr != known_only.get_hdr(header_name::RANGE));
+}
+
+BOOST_AUTO_TEST_CASE( url_fields_case )
+{
+    using ecl::web::url_field;
+
+    ecl::web::request_cache<64, 1> c;
+
+    char url[] = "/path/to?a=1&b=2#top";
+    c.set_url(url);
+
+    BOOST_CHECK(0 == std::strcmp("/path/to", c.get_url(url_field::PATH)));
+    BOOST_CHECK(0 == std::strcmp("a=1&b=2", c.get_url(url_field::QUERY)));
+    BOOST_CHECK(0 == std::strcmp("top", c.get_url(url_field::FRAGMENT)));
+    BOOST_CHECK(nullptr == c.get_url(url_field::HOST));
+    BOOST_CHECK(nullptr == c.get_url(url_field::UNKNOWN));
+
+    char other[] = "/other";
+    c.set_url(other);
+
+    BOOST_CHECK(0 == std::strcmp("/other", c.get_url(url_field::PATH)));
+    BOOST_CHECK(nullptr == c.get_url(url_field::QUERY));
+}
+
+BOOST_AUTO_TEST_CASE( url_params_case )
+{
+    ECL_DECL_NAME_TYPE(city)
+
+    char query[] = "a=1&city=New+York&b=%41%2b%zz&flag&&c=&%00=x";
+    ecl::web::url_params p(query, sizeof(query) - 1);
+
+    BOOST_CHECK(5 == p.size());
+    BOOST_CHECK(0 == std::strcmp("1", p.get("a")));
+    BOOST_CHECK(0 == std::strcmp("New York", p.get<city>()));
+    BOOST_CHECK(0 == std::strcmp("A+%zz", p.get("b")));
+    BOOST_CHECK(0 == std::strcmp("", p.get("c")));
+    BOOST_CHECK(0 == std::strcmp("x", p.get("%00")));
+    BOOST_CHECK(nullptr == p.get("flag"));
+    BOOST_CHECK(nullptr == p.get("ci"));
+
+    std::string names;
+    for(ecl::web::url_param_t param : p)
+    {
+        names += param.first;
+    }
+
+    BOOST_CHECK("acitybc%00" == names);
+
+    ecl::web::url_params empty;
+    BOOST_CHECK(empty.begin() == empty.end());
+    BOOST_CHECK(nullptr == empty.get("a"));
+
+    // Same escapes are decoded in paths of file_resource.
+    const char esc[] = "%41%00%4";
+    BOOST_CHECK('A' == ecl::web::percent_decode(esc, esc + 8));
+    BOOST_CHECK(-1  == ecl::web::percent_decode(esc + 3, esc + 8));
+    BOOST_CHECK(-1  == ecl::web::percent_decode(esc + 6, esc + 8));
+}
+
+BOOST_AUTO_TEST_CASE( request_params_case )
+{
+    ecl::web::request_cache<64, 1> c;
+
+    char url[] = "/form?q=a%20b";
+    c.set_url(url);
+
+    // Decoded once, second call sees the same values.
+    BOOST_CHECK(0 == std::strcmp("a b", c.get_query().get("q")));
+    BOOST_CHECK(0 == std::strcmp("a b", c.get_query().get("q")));
+
+    char body[] = "x=%31";
+    c.set_body(std::make_pair(body, sizeof(body) - 1));
+
+    BOOST_CHECK(0 == c.get_form().size());
+
+    c.clear();
+    c.set_hdr(std::make_pair("Content-Type", "application/x-www-form-urlencoded; charset=utf-8"));
+    c.set_body(std::make_pair(body, sizeof(body) - 1));
+
+    BOOST_CHECK(0 == std::strcmp("1", c.get_form().get("x")));
+    BOOST_CHECK(0 == c.get_query().size());
+}
+
+BOOST_AUTO_TEST_CASE( range_parse_case )
+{
+    ecl::web::request_cache<64, 4> c;
+
+    auto range = [&c](const char* value, std::size_t size, ecl::web::range_t& r)
+    {
+        c.clear();
+        c.set_hdr(std::make_pair("Range", value));
+        return c.get_range(size, r);
+    };
+
+    ecl::web::range_t r {};
+
+    BOOST_CHECK(ecl::web::range_status::SATISFIABLE == range("bytes=0-9", 100, r));
+    BOOST_CHECK((r.first == 0) && (r.second == 10));
+
+    BOOST_CHECK(ecl::web::range_status::SATISFIABLE == range("bytes=90-", 100, r));
+    BOOST_CHECK((r.first == 90) && (r.second == 10));
+
+    BOOST_CHECK(ecl::web::range_status::SATISFIABLE == range("bytes=-30", 100, r));
+    BOOST_CHECK((r.first == 70) && (r.second == 30));
+
+    BOOST_CHECK(ecl::web::range_status::SATISFIABLE == range("bytes=50-500", 100, r));
+    BOOST_CHECK((r.first == 50) && (r.second == 50));
+
+    BOOST_CHECK(ecl::web::range_status::NOT_SATISFIABLE == range("bytes=100-", 100, r));
+    BOOST_CHECK(ecl::web::range_status::NOT_SATISFIABLE == range("bytes=-0", 100, r));
+
+    BOOST_CHECK(ecl::web::range_status::NONE == range("bytes=9-1", 100, r));
+    BOOST_CHECK(ecl::web::range_status::NONE == range("bytes=0-1,5-6", 100, r));
+    BOOST_CHECK(ecl::web::range_status::NONE == range("items=0-1", 100, r));
+    BOOST_CHECK(ecl::web::range_status::NONE == range("bytes=x-1", 100, r));
+}
+
+BOOST_FIXTURE_TEST_CASE( partial_content_case, web_fixture )
+{
+    server_t::static_resource_t<binary_data> bin;
+    srv.attach_resource("/bin", bin);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /bin HTTP/1.1\r\nRange: bytes=1-3\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 206"));
+    // Same type as full response has.
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Type:image/png\r\n"));
+    BOOST_CHECK(ecl::web::content_type::IMAGE_PNG == bin.get_content_type());
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Range:bytes 1-3/200\r\n"));
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Length:3\r\n"));
+    BOOST_CHECK(std::string::npos == out_1.find("Content-Length:200\r\n"));
+    BOOST_CHECK(std::string::npos != out_1.find("Cache-Control:no-cache\r\n"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 3) == std::string("\x00\x02\x00", 3));
+
+    out_1.clear();
+    rq = "GET /bin HTTP/1.1\r\nRange: bytes=200-\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 416"));
+
+    out_1.clear();
+    rq = "GET /bin HTTP/1.1\r\nRange: bytes=1-3\r\nIf-Range: \"old\"\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+}
+
+struct encoded_data
+{
+    static constexpr char mime_type[] = "text/plain";
+
+    static constexpr unsigned char response[] = "Content-Length:8\r\nETag:\"id\"\r\n"
+                                                "Vary:Accept-Encoding\r\n\r\nidentity";
+    static constexpr std::size_t   response_size     = sizeof(response) - 1;
+    static constexpr std::size_t   headers_size      = response_size - 8;
+    static constexpr std::size_t   length_size       = 18;
+    static constexpr std::size_t   validators_offset = 18;
+
+    static constexpr const unsigned char* data = response + headers_size;
+    static constexpr std::size_t          size = 8;
+
+    static constexpr char etag[] = "\"id\"";
+
+    struct gzip
+    {
+        static constexpr unsigned char response[] = "Content-Length:2\r\nContent-Encoding:gzip\r\n"
+                                                    "ETag:\"gz\"\r\nVary:Accept-Encoding\r\n\r\ngz";
+        static constexpr std::size_t   response_size     = sizeof(response) - 1;
+        static constexpr std::size_t   headers_size      = response_size - 2;
+        static constexpr std::size_t   length_size       = 18;
+        static constexpr std::size_t   validators_offset = 41;
+
+        static constexpr const unsigned char* data = response + headers_size;
+        static constexpr std::size_t          size = 2;
+
+        static constexpr char etag[] = "\"gz\"";
+    };
+};
+
+constexpr char          encoded_data::mime_type[];
+constexpr unsigned char encoded_data::response[];
+constexpr char          encoded_data::etag[];
+constexpr unsigned char encoded_data::gzip::response[];
+constexpr char          encoded_data::gzip::etag[];
+
+BOOST_AUTO_TEST_CASE( accept_encoding_case )
+{
+    using ecl::web::content_encoding;
+    using ecl::web::is_encoding_accepted;
+
+    BOOST_CHECK(is_encoding_accepted(nullptr, content_encoding::IDENTITY));
+    BOOST_CHECK(!is_encoding_accepted(nullptr, content_encoding::GZIP));
+    BOOST_CHECK(is_encoding_accepted("deflate, GZIP", content_encoding::GZIP));
+    BOOST_CHECK(!is_encoding_accepted("gzip;q=0, br", content_encoding::GZIP));
+    BOOST_CHECK(is_encoding_accepted("gzip;q=0.5", content_encoding::GZIP));
+    BOOST_CHECK(!is_encoding_accepted("gzip;q=0.000", content_encoding::GZIP));
+    BOOST_CHECK(is_encoding_accepted("*", content_encoding::BR));
+    BOOST_CHECK(!is_encoding_accepted("*;q=0", content_encoding::IDENTITY));
+    BOOST_CHECK(!is_encoding_accepted("identity;q=0, *", content_encoding::IDENTITY));
+    BOOST_CHECK(!is_encoding_accepted("gzipx", content_encoding::GZIP));
+}
+
+BOOST_FIXTURE_TEST_CASE( content_encoding_case, web_fixture )
+{
+    server_t::static_resource_t<encoded_data> enc;
+    srv.attach_resource("/enc", enc);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /enc HTTP/1.1\r\nAccept-Encoding: gzip, deflate\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 2) == "gz");
+
+    out_1.clear();
+    rq = "GET /enc HTTP/1.1\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(out_1.substr(out_1.size() - 8) == "identity");
+
+    out_1.clear();
+    rq = "GET /enc HTTP/1.1\r\nAccept-Encoding: br\r\nIf-None-Match: \"gz\"\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 8) == "identity");
+
+    // 304 keeps Vary of the variant, so caches don't mix variants up.
+    out_1.clear();
+    rq = "GET /enc HTTP/1.1\r\nAccept-Encoding: gzip\r\nIf-None-Match: \"gz\"\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 304"));
+    BOOST_CHECK(std::string::npos != out_1.find("Vary:Accept-Encoding\r\n"));
+    BOOST_CHECK(std::string::npos == out_1.find("Content-Encoding"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 4) == "\r\n\r\n");
+
+    out_1.clear();
+    rq = "GET /enc HTTP/1.1\r\nAccept-Encoding: gzip\r\nRange: bytes=1-\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 206"));
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Encoding:gzip\r\n"));
+    BOOST_CHECK(std::string::npos != out_1.find("Vary:Accept-Encoding\r\n"));
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Length:1\r\n"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 1) == "z");
+}
+
+BOOST_AUTO_TEST_CASE( route_table_case )
+{
+    ECL_DECL_NAME_TYPE_STRING(route_name, "/name")
+
+    static_assert(ecl::web::url_hash("/name") ==
+                  ecl::web::url_hash(route_name::name()), "hash mismatch");
+
+    int res_1 = 1;
+    int res_2 = 2;
+    int res_3 = 3;
+
+    ecl::web::route_table<int, 2> table;
+
+    BOOST_CHECK(table.attach<route_name>(res_1));
+    BOOST_CHECK(table.attach("/other", res_2));
+    BOOST_CHECK(!table.attach("/name", res_3));
+    BOOST_CHECK(!table.attach("/third", res_3));
+
+    BOOST_CHECK(&res_1 == table.find("/name"));
+    BOOST_CHECK(&res_2 == table.find("/other"));
+    BOOST_CHECK(nullptr == table.find("/nam"));
+    BOOST_CHECK(nullptr == table.find(nullptr));
+    BOOST_CHECK(2 == table.size());
+
+    BOOST_CHECK(ecl::web::url_hash("/name") ==
+                ecl::web::runtime_url_hash("/name"));
+    BOOST_CHECK(ecl::web::url_hash("") == ecl::web::runtime_url_hash(""));
+
+    // URL of request size, hashed at runtime.
+    std::string long_url_1("/" + std::string(1500, 'a'));
+    std::string long_url_2("/" + std::string(1499, 'a') + "b");
+
+    int res_4 = 4;
+    ecl::web::route_table<int, 2> long_table;
+
+    BOOST_CHECK(long_table.attach(long_url_1.c_str(), res_4));
+    BOOST_CHECK(&res_4 == long_table.find(long_url_1.c_str()));
+    BOOST_CHECK(nullptr == long_table.find(long_url_2.c_str()));
+}
+
+BOOST_AUTO_TEST_CASE( router_case )
+{
+    int res_1 = 1;
+    int res_2 = 2;
+    int res_3 = 3;
+    int res_4 = 4;
+
+    ecl::web::router<int, 16> r;
+
+    BOOST_CHECK(r.attach("/sensor/{id}",         res_1));
+    BOOST_CHECK(r.attach("/sensor/{id}/history", res_2));
+    BOOST_CHECK(r.attach("/sensor/all",          res_3));
+    BOOST_CHECK(r.attach("/etc/*",               res_4));
+    BOOST_CHECK(!r.attach("/sensor/{id}",        res_4));
+    BOOST_CHECK(!r.attach("/bad/*/suffix",       res_4));
+
+    ecl::web::request_cache<16, 1> c;
+
+    BOOST_CHECK(&res_3 == r.find("/sensor/all", c));
+    BOOST_CHECK(nullptr == c.get_param("id"));
+
+    c.clear();
+    BOOST_CHECK(&res_1 == r.find("/sensor/42", c));
+    BOOST_CHECK(std::string("42") == c.get_param("id"));
+
+    c.clear();
+    BOOST_CHECK(&res_2 == r.find("/sensor/17/history", c));
+    BOOST_CHECK(std::string("17") == c.get_param("id"));
+
+    c.clear();
+    BOOST_CHECK(&res_4 == r.find("/etc/js/jquery.js", c));
+    BOOST_CHECK(std::string("js/jquery.js") == c.get_param("*"));
+
+    c.clear();
+    BOOST_CHECK(nullptr == r.find("/sensor/", c));
+    BOOST_CHECK(nullptr == r.find("/sensor/17/other", c));
+    BOOST_CHECK(nullptr == r.find("/et", c));
+}
+
+BOOST_FIXTURE_TEST_CASE( pattern_resource_case, web_fixture )
+{
+    BOOST_CHECK(srv.attach_resource("/files/*", res));
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /files/a/b.txt HTTP/1.1\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(1 == res.m_calls);
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+}
+
+struct upload_resource : public server_t::i_resource_t
+{
+    virtual ~upload_resource()                                 noexcept override
+    {}
+
+    virtual bool on_body_begin(ecl::web::i_request_cache&)     noexcept override
+    {
+        return true;
+    }
+
+    virtual ecl::web::status_code on_body_chunk(
+            ecl::web::i_request_cache&,
+            const char*                at,
+            std::size_t                length
+        )                                                      noexcept override
+    {
+        m_body.append(at, length);
+
+        return (m_body.size() > m_limit) ? ecl::web::status_code::REQUEST_ENTITY_TOO_LARGE
+                                         : ecl::web::status_code::OK;
+    }
+
+    virtual ecl::web::status_code on_request(
+            server_t::stream_t&        st,
+            ecl::web::i_request_cache& c
+        )                                                      noexcept override
+    {
+        ++m_calls;
+        m_empty = (nullptr == c.get_body().first);
+
+        ecl::web::header_value_t host    = c.get_hdr(ecl::web::header_name::HOST);
+        ecl::web::header_value_t trailer = c.get_hdr("X-Trailer");
+        m_host    = host ? host : "";
+        m_trailer = trailer ? trailer : "";
+
+        ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+        st << "\r\n";
+        st.flush();
+
+        return ecl::web::status_code::OK;
+    }
+
+    std::size_t m_limit   { 4096 };
+    std::size_t m_calls   { 0 };
+    bool        m_empty   { false };
+    std::string m_body    {};
+    std::string m_host    {};
+    std::string m_trailer {};
+};
+
+static void write_file(const std::string& path, const std::string& data)
+{
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    BOOST_REQUIRE(nullptr != f);
+
+    std::fwrite(data.data(), 1, data.size(), f);
+    std::fclose(f);
+}
+
+BOOST_FIXTURE_TEST_CASE( file_resource_case, web_fixture )
+{
+    char dir[] = "/tmp/ecl_web_files_XXXXXX";
+    BOOST_REQUIRE(nullptr != mkdtemp(dir));
+
+    const std::string root(dir);
+    write_file(root + "/page.html", "<p>file</p>");
+    write_file(root + "/page.html.gz", "gz");
+
+    ecl::web::file_resource<server_t::stream_t, 2> files(dir, 0);
+    BOOST_REQUIRE(srv.attach_resource("/files/*", files));
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /files/page.html HTTP/1.1\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Type:text/html\r\n"));
+    BOOST_CHECK(std::string::npos != out_1.find("Vary:Accept-Encoding\r\n"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 11) == "<p>file</p>");
+
+    // Escaped path and compressed sibling.
+    out_1.clear();
+    rq = "GET /files/p%61ge.html HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Encoding:gzip\r\n"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 2) == "gz");
+
+    out_1.clear();
+    rq = "GET /files/page.html HTTP/1.1\r\nRange: bytes=3-6\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 206"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 4) == "file");
+
+    // Replaced file is noticed, as it is checked on each request.
+    std::string::size_type tag = out_1.find("ETag:");
+    std::string            etag(out_1.substr(tag + 5, out_1.find("\r\n", tag) - tag - 5));
+
+    out_1.clear();
+    rq = "GET /files/page.html HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 304"));
+    BOOST_CHECK(std::string::npos != out_1.find("Vary:Accept-Encoding\r\n"));
+    BOOST_CHECK(std::string::npos != out_1.find("Cache-Control:no-cache\r\n"));
+
+    write_file(root + "/page.html.tmp", "new");
+    BOOST_REQUIRE(0 == std::rename((root + "/page.html.tmp").c_str(), (root + "/page.html").c_str()));
+
+    out_1.clear();
+    rq = "GET /files/page.html HTTP/1.1\r\nIf-None-Match: " + etag + "\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 3) == "new");
+
+    // File, truncated in place after it is cached, is sent as far as it
+    // goes.
+    ecl::web::file_resource<server_t::stream_t, 2> cached(dir, 1000000);
+    BOOST_REQUIRE(srv.attach_resource("/cached/*", cached));
+
+    out_1.clear();
+    rq = "GET /cached/page.html HTTP/1.1\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(out_1.substr(out_1.size() - 3) == "new");
+
+    BOOST_REQUIRE(0 == truncate((root + "/page.html").c_str(), 0));
+
+    out_1.clear();
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Length:3\r\n"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 4) == "\r\n\r\n");
+
+    const char* refused[] =
+    {
+          "GET /files/../etc/passwd HTTP/1.1\r\n\r\n"
+        , "GET /files/a/%2e%2e/page.html HTTP/1.1\r\n\r\n"
+        , "GET /files/missing.html HTTP/1.1\r\n\r\n"
+        , "GET /files/ HTTP/1.1\r\n\r\n"
+    };
+
+    for(const char* r : refused)
+    {
+        out_1.clear();
+        c->process_request(r, std::strlen(r));
+
+        BOOST_CHECK(0 == out_1.find("HTTP/1.1 404"));
+    }
+
+    std::remove((root + "/page.html").c_str());
+    std::remove((root + "/page.html.gz").c_str());
+    rmdir(dir);
+}
+
+BOOST_FIXTURE_TEST_CASE( file_resource_pin_case, web_fixture )
+{
+    char dir[] = "/tmp/ecl_web_files_XXXXXX";
+    BOOST_REQUIRE(nullptr != mkdtemp(dir));
+
+    const std::string root(dir);
+    write_file(root + "/page.html", "old");
+    write_file(root + "/other.html", "o");
+
+    ecl::web::file_resource<server_t::stream_t, 2> files(dir, 0);
+    ecl::web::file_resource<server_t::stream_t, 1> single(dir, 0);
+    BOOST_REQUIRE(srv.attach_resource("/files/*", files));
+    BOOST_REQUIRE(srv.attach_resource("/single/*", single));
+
+    server_t::connection_t* c_2 = srv.open(sink(out_2));
+    BOOST_REQUIRE(nullptr != c_2);
+
+    // Other request is served, while file is sent: cache isn't locked.
+    std::function<void()> nested;
+    server_t::connection_t* c = srv.open([&](const char* const buf, std::size_t size)
+    {
+        out_1.append(buf, size);
+
+        if(nested)
+        {
+            std::function<void()> n;
+            n.swap(nested);
+            n();
+        }
+    });
+    BOOST_REQUIRE(nullptr != c);
+
+    // File, that is replaced while it is sent, is loaded to another slot.
+    std::string rq("GET /files/page.html HTTP/1.1\r\n\r\n");
+
+    nested = [&]()
+    {
+        write_file(root + "/page.html.tmp", "new");
+        std::rename((root + "/page.html.tmp").c_str(), (root + "/page.html").c_str());
+
+        c_2->process_request(rq.data(), rq.size());
+    };
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(out_1.substr(out_1.size() - 3) == "old");
+    BOOST_CHECK(0 == out_2.find("HTTP/1.1 200"));
+    BOOST_CHECK(out_2.substr(out_2.size() - 3) == "new");
+
+    out_1.clear();
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(out_1.substr(out_1.size() - 3) == "new");
+
+    // Pinned slot isn't reused.
+    out_1.clear();
+    out_2.clear();
+    nested = [&]()
+    {
+        const std::string other("GET /single/other.html HTTP/1.1\r\n\r\n");
+        c_2->process_request(other.data(), other.size());
+    };
+    rq = "GET /single/page.html HTTP/1.1\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(out_1.substr(out_1.size() - 3) == "new");
+    BOOST_CHECK(0 == out_2.find("HTTP/1.1 503"));
+
+    out_2.clear();
+    rq = "GET /single/other.html HTTP/1.1\r\n\r\n";
+    c_2->process_request(rq.data(), rq.size());
+    BOOST_CHECK(out_2.substr(out_2.size() - 1) == "o");
+
+    std::remove((root + "/page.html").c_str());
+    std::remove((root + "/other.html").c_str());
+    rmdir(dir);
+}
+
+struct test_clock
+{
+    using duration   = std::chrono::milliseconds;
+    using time_point = std::chrono::time_point<test_clock>;
+
+    static duration& current()
+    {
+        static duration d { 0 };
+        return d;
+    }
+
+    static time_point now()
+    {
+        return time_point(current());
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE( cached_resource_case, web_fixture )
+{
+    using cached_t = ecl::web::cached_resource<server_t::stream_t, 2, 256, 32, test_clock>;
+
+    cached_t cached(res, std::chrono::milliseconds(100));
+    srv.attach_resource("/cached", cached);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    auto get = [&](const std::string& url) -> std::string
+    {
+        out_1.clear();
+
+        std::string rq("GET " + url + " HTTP/1.1\r\n\r\n");
+        c->process_request(rq.data(), rq.size());
+
+        return out_1;
+    };
+
+    const std::string first = get("/cached?a=1");
+
+    BOOST_CHECK(0 == first.find("HTTP/1.1 200"));
+    BOOST_CHECK(1 == res.m_calls);
+
+    BOOST_CHECK(get("/cached?a=1") == first);
+    BOOST_CHECK(1 == res.m_calls);
+
+    // Other query is other response.
+    get("/cached?a=2");
+    BOOST_CHECK(2 == res.m_calls);
+
+    test_clock::current() += std::chrono::milliseconds(100);
+    BOOST_CHECK(get("/cached?a=1") == first);
+    BOOST_CHECK(3 == res.m_calls);
+
+    get("/cached?a=1");
+    BOOST_CHECK(3 == res.m_calls);
+
+    cached.invalidate();
+    get("/cached?a=1");
+    BOOST_CHECK(4 == res.m_calls);
+
+    // Only GET is cached.
+    out_1.clear();
+    std::string rq("POST /cached?a=1 HTTP/1.1\r\nContent-Length: 0\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(5 == res.m_calls);
+
+    // Too long key is not cached.
+    get("/cached?a=0123456789012345678901234567890123456789");
+    get("/cached?a=0123456789012345678901234567890123456789");
+    BOOST_CHECK(7 == res.m_calls);
+    // Chunked body, left open by resource, is stored with the last chunk.
+    struct open_chunked_resource : public server_t::i_resource_t
+    {
+        virtual ecl::web::status_code on_request(
+                server_t::stream_t&        st,
+                ecl::web::i_request_cache& c
+            )                                                  noexcept override
+        {
+            ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+            ecl::web::set_chunked_header(st);
+            st << "\r\n";
+
+            st.begin_chunked();
+            st << "body";
+            st.flush();
+
+            return ecl::web::status_code::OK;
+        }
+    };
+
+    open_chunked_resource chunked;
+    cached_t              cached_chunked(chunked, std::chrono::milliseconds(100));
+    srv.attach_resource("/chunked", cached_chunked);
+
+    const std::string chunked_first = get("/chunked");
+    BOOST_CHECK(chunked_first.size() - 5 == chunked_first.find("0\r\n\r\n"));
+    BOOST_CHECK(get("/chunked") == chunked_first);
+}
+
+// Client frame with mask.
+static std::string ws_client_frame(uint8_t first, const std::string& payload)
+{
+    const char mask[4] = { 0x37, static_cast<char>(0xfa), 0x21, 0x3d };
+
+    std::string f;
+    f += static_cast<char>(first);
+    f += static_cast<char>(0x80 | payload.size());
+    f.append(mask, sizeof(mask));
+
+    for(std::size_t i = 0; i < payload.size(); ++i)
+    {
+        f += static_cast<char>(payload[i] ^ mask[i % 4]);
+    }
+
+    return f;
+}
+
+BOOST_FIXTURE_TEST_CASE( websocket_case, web_fixture )
+{
+    using ws_base_t = ecl::web::websocket_resource<server_t::stream_t, 1, 16>;
+
+    struct echo_resource : public ws_base_t
+    {
+        virtual void on_message(session&           s,
+                                ecl::web::ws_opcode op,
+                                const char*        data,
+                                std::size_t        size)           noexcept override
+        {
+            m_last.assign(data, size);
+            s.send(op, data, size);
+        }
+
+        virtual void on_open(session& s)                       noexcept override
+        {
+            m_session = &s;
+        }
+
+        virtual void on_close(session&)                        noexcept override
+        {
+            ++m_closed;
+        }
+
+        // Request is still in the cache.
+        virtual ecl::web::i_session<server_t::stream_t>* open_session(
+                server_t::stream_t&        st,
+                ecl::web::i_request_cache& c
+            )                                                  noexcept override
+        {
+            ecl::web::header_value_t key = c.get_hdr(ecl::web::header_name::SEC_WEBSOCKET_KEY);
+            m_key = (nullptr != key) ? key : "";
+
+            return ws_base_t::open_session(st, c);
+        }
+
+        session*    m_session { nullptr };
+        std::string m_key     {};
+        std::string m_last    {};
+        std::size_t m_closed  { 0 };
+    };
+
+    char accept[29];
+    ecl::web::websocket_accept("dGhlIHNhbXBsZSBub25jZQ==", accept);
+    BOOST_CHECK(std::string("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == accept);
+
+    echo_resource ws;
+    srv.attach_resource("/ws", ws);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    // Frames in the same packet as handshake go to the session.
+    std::string rq("GET /ws HTTP/1.1\r\n"
+                   "Upgrade: websocket\r\n"
+                   "Connection: Upgrade\r\n"
+                   "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                   "Sec-WebSocket-Version: 13\r\n\r\n");
+    rq += ws_client_frame(0x89, std::string(100, 'p'));
+    rq += ws_client_frame(0x81, "Hello");
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 101"));
+    BOOST_CHECK(std::string::npos != out_1.find("Sec-WebSocket-Accept:s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"));
+    BOOST_CHECK("Hello" == ws.m_last);
+    BOOST_CHECK_MESSAGE("dGhlIHNhbXBsZSBub25jZQ==" == ws.m_key, ws.m_key);
+    BOOST_CHECK(std::string("\x81\x05" "Hello") == out_1.substr(out_1.size() - 7));
+
+    // Fragments with ping between them, byte by byte.
+    out_1.clear();
+    rq = ws_client_frame(0x01, "Hel") + ws_client_frame(0x89, "p") + ws_client_frame(0x80, "lo!");
+    for(char ch : rq)
+    {
+        c->process_request(&ch, 1);
+    }
+
+    BOOST_CHECK("Hello!" == ws.m_last);
+    BOOST_CHECK(std::string("\x8a\x01p" "\x81\x06" "Hello!") == out_1);
+
+    // Session is the only one.
+    server_t::connection_t* c_2 = srv.open(sink(out_2));
+    BOOST_REQUIRE(nullptr != c_2);
+    std::string rq_2("GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: x\r\n"
+           "Sec-WebSocket-Version: 13\r\n\r\n");
+    c_2->process_request(rq_2.data(), rq_2.size());
+    BOOST_CHECK(0 == out_2.find("HTTP/1.1 503"));
+
+    out_1.clear();
+    ws.broadcast(ecl::web::ws_opcode::TEXT, "all", 3);
+    BOOST_CHECK(std::string("\x81\x03" "all") == out_1);
+
+    // Message is fragmented, when it doesn't fit writer buffer.
+    out_1.clear();
+    ecl::web::websocket_writer<4, server_t::stream_t> w(ws.m_session->stream());
+    w << "abcdefghij" << ecl::end();
+
+    std::string payload;
+    for(std::size_t i = 0; i + 2 <= out_1.size(); i += 2 + out_1[i + 1])
+    {
+        const uint8_t op = out_1[i] & 0x0f;
+
+        BOOST_CHECK((0 == i) ? (1 == op) : (0 == op));
+        BOOST_CHECK((0x80 == (out_1[i] & 0x80)) == (i + 2 + out_1[i + 1] == out_1.size()));
+        payload.append(out_1, i + 2, out_1[i + 1]);
+    }
+    BOOST_CHECK("abcdefghij" == payload);
+
+    // Too big message.
+    out_1.clear();
+    rq = ws_client_frame(0x82, std::string(17, 'x'));
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(std::string("\x88\x02\x03\xf1", 4) == out_1);
+    BOOST_CHECK(1 == ws.m_closed);
+    BOOST_CHECK(!c->is_keep_alive());
+}
+
+BOOST_FIXTURE_TEST_CASE( websocket_close_case, web_fixture )
+{
+    ecl::web::websocket_resource<server_t::stream_t> ws;
+    srv.attach_resource("/ws", ws);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    std::string rq("GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                   "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n");
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 400"));
+
+    // Connection must list Upgrade.
+    srv.close(c);
+    out_1.clear();
+    c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    rq = "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: keep-alive\r\n"
+         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 400"));
+
+    srv.close(c);
+    out_1.clear();
+    c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    rq = "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\n"
+         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 400"));
+
+    BOOST_CHECK(ecl::web::has_header_token("keep-alive, Upgrade", "upgrade"));
+    BOOST_CHECK(ecl::web::has_header_token("UPGRADE", "upgrade"));
+    BOOST_CHECK(!ecl::web::has_header_token("Upgraded", "upgrade"));
+    BOOST_CHECK(!ecl::web::has_header_token(nullptr, "upgrade"));
+
+    rq = "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n"
+         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    c = srv.open(sink(out_2));
+    BOOST_REQUIRE(nullptr != c);
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(0 == out_2.find("HTTP/1.1 101"));
+
+    // Close is echoed and connection is closed.
+    out_2.clear();
+    rq = ws_client_frame(0x88, "\x03\xe8");
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(std::string("\x88\x02\x03\xe8") == out_2);
+    BOOST_CHECK(!c->is_keep_alive());
+
+    // Unmasked frame is protocol error.
+    srv.close(c);
+    out_1.clear();
+    c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    rq = "GET /ws HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n"
+         "\x81\x01x";
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(std::string("\x88\x02\x03\xea") == out_1.substr(out_1.size() - 4));
+    BOOST_CHECK(!c->is_keep_alive());
+
+    // Close of the server is answered by client, answer isn't echoed.
+    struct closing_resource : public ecl::web::websocket_resource<server_t::stream_t>
+    {
+        virtual void on_open(session& s)                       noexcept override
+        {
+            m_session = &s;
+        }
+
+        session* m_session { nullptr };
+    };
+
+    closing_resource closing;
+    srv.attach_resource("/closing", closing);
+
+    srv.close(c);
+    c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    rq = "GET /closing HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+         "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    c->process_request(rq.data(), rq.size());
+    BOOST_REQUIRE(nullptr != closing.m_session);
+
+    out_1.clear();
+    closing.m_session->close(ecl::web::ws_close::NORMAL);
+    closing.m_session->close(ecl::web::ws_close::NORMAL);
+    closing.m_session->send_text("late");
+    BOOST_CHECK(std::string("\x88\x02\x03\xe8") == out_1);
+
+    rq = ws_client_frame(0x88, "\x03\xe8");
+    c->process_request(rq.data(), rq.size());
+    BOOST_CHECK(std::string("\x88\x02\x03\xe8") == out_1);
+    BOOST_CHECK(!c->is_keep_alive());
+}
+
+BOOST_FIXTURE_TEST_CASE( sse_resource_case, web_fixture )
+{
+    struct events_resource : public ecl::web::sse_resource<server_t::stream_t, 1, 16>
+    {
+        virtual void on_subscribe(server_t::stream_t&      st,
+                                  ecl::web::header_value_t id) noexcept override
+        {
+            m_last_id = (nullptr != id) ? id : "";
+            st << "retry:1000\n\n";
+        }
+
+        std::string m_last_id {};
+    };
+
+    events_resource sse;
+    srv.attach_resource("/events", sse);
+
+    server_t::connection_t* c_1 = srv.open(sink(out_1));
+    server_t::connection_t* c_2 = srv.open(sink(out_2));
+    BOOST_REQUIRE(nullptr != c_1);
+    BOOST_REQUIRE(nullptr != c_2);
+
+    std::string rq("GET /events HTTP/1.1\r\nLast-Event-ID: 7\r\n\r\n");
+    c_1->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(0 == out_1.find("HTTP/1.1 200"));
+    BOOST_CHECK(std::string::npos != out_1.find("Content-Type:text/event-stream\r\n"));
+    BOOST_CHECK(out_1.size() - 16 == out_1.find("\r\n\r\nretry:1000\n\n"));
+    BOOST_CHECK("7" == sse.m_last_id);
+    BOOST_CHECK(1 == sse.subscribers_count());
+
+    // No free subscribers.
+    c_2->process_request(rq.data(), rq.size());
+    BOOST_CHECK(0 == out_2.find("HTTP/1.1 503"));
+
+    // Event is larger than the buffer.
+    out_1.clear();
+    sse.publish("first line\nsecond line", "update", "8");
+    BOOST_CHECK("event:update\nid:8\ndata:first line\ndata:second line\n\n" == out_1);
+
+    // Line breaks of any kind start new data field.
+    out_1.clear();
+    sse.publish("a\rb\r\nc\nd");
+    BOOST_CHECK("data:a\ndata:b\ndata:c\ndata:d\n\n" == out_1);
+
+    // CRLF is split between parts of the event, CR can't inject a field.
+    out_1.clear();
+    sse.publish_value("0123456789abcde\r\nx\r\rid:1");
+    BOOST_CHECK_MESSAGE("data:0123456789abcde\ndata:x\ndata:\ndata:id:1\n\n" == out_1, out_1);
+
+    // Line breaks of event name and id are dropped.
+    out_1.clear();
+    sse.publish("x", "up\r\ndata:evil\n", "9\rretry:1\n\n");
+    BOOST_CHECK_MESSAGE("event:updata:evil\nid:9retry:1\ndata:x\n\n" == out_1, out_1);
+
+    // Data of the client doesn't end subscription.
+    c_1->process_request(rq.data(), rq.size());
+
+    srv.close(c_2);
+    c_2 = srv.open(sink(out_2));
+    BOOST_REQUIRE(nullptr != c_2);
+
+    srv.close(c_1);
+    BOOST_CHECK(0 == sse.subscribers_count());
+
+    out_1.clear();
+    out_2.clear();
+    c_2->process_request(rq.data(), rq.size());
+    out_2.clear();
+
+    sse.publish_value(42);
+    sse.heartbeat();
+    BOOST_CHECK("data:42\n\n:\n\n" == out_2);
+    BOOST_CHECK(out_1.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE( streamed_body_case, web_fixture )
+{
+    upload_resource upload;
+    srv.attach_resource("/upload", upload);
+
+    server_t::connection_t* c = srv.open(sink(out_1));
+    BOOST_REQUIRE(nullptr != c);
+
+    // Body is much larger than the cache.
+    std::string body;
+    for(std::size_t i = 0; body.size() < 2000; ++i)
+    {
+        body += static_cast<char>('a' + i % 26);
+    }
+
+    std::string rq("POST /upload HTTP/1.1\r\nContent-Length: 2000\r\n\r\n");
+    rq += body;
+    rq += "POST /upload HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "5\r\nhello\r\n6\r\n world\r\n0\r\nX-Trailer: 1\r\n\r\n";
+
+    for(std::size_t i = 0; i < rq.size(); i += 100)
+    {
+        c->process_request(rq.data() + i, std::min<std::size_t>(100, rq.size() - i));
+    }
+
+    BOOST_CHECK(2 == upload.m_calls);
+    BOOST_CHECK(upload.m_empty);
+    BOOST_CHECK(body + "hello world" == upload.m_body);
+    // Trailers of streamed body are dropped with it.
+    BOOST_CHECK("h" == upload.m_host);
+    BOOST_CHECK(upload.m_trailer.empty());
+    BOOST_CHECK(std::string::npos == out_1.find("HTTP/1.1 413"));
+    BOOST_CHECK(c->is_keep_alive());
+
+    // Resource refuses the body.
+    upload.m_limit = 0;
+    rq = "POST /upload HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody";
+    c->process_request(rq.data(), rq.size());
+
+    BOOST_CHECK(2 == upload.m_calls);
+    BOOST_CHECK(std::string::npos != out_1.find("HTTP/1.1 413"));
+    BOOST_CHECK(!c->is_keep_alive());
+}
+
+struct string_sink
+{
+    void write(const char* const buf, std::size_t size)
+    {
+        m_out->append(buf, size);
+    }
+
+    std::string* m_out;
+};
+
+std::string function_sink_out;
+
+void function_sink(const char* const buf, std::size_t size)
+{
+    function_sink_out.append(buf, size);
+}
+
+BOOST_AUTO_TEST_CASE( sink_case )
+{
+    using sink_server_t = ecl::web::server
+                          <
+                                512, 128, 8, 8, 8, 1, 8
+                              , ecl::web::request_cache
+                              , string_sink
+                          >;
+
+    struct sink_resource : public sink_server_t::i_resource_t
+    {
+        virtual ~sink_resource()                               noexcept override
+        {}
+
+        virtual ecl::web::status_code on_request(
+                sink_server_t::stream_t&   st,
+                ecl::web::i_request_cache& c
+            )                                                  noexcept override
+        {
+            ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+            st << "\r\n" << "sink";
+            st.flush();
+
+            return ecl::web::status_code::OK;
+        }
+    };
+
+    std::string   out;
+    sink_server_t srv(string_sink { &out });
+    sink_resource res;
+
+    srv.attach_resource("/sink", res);
+
+    const char rq[] = "GET /sink HTTP/1.1\r\n\r\n";
+    srv.process_request(rq, sizeof(rq) - 1);
+
+    BOOST_CHECK(0 == out.find("HTTP/1.1 200"));
+    BOOST_CHECK(out.substr(out.size() - 4) == "sink");
+
+    // Function pointer, data larger than buffer goes directly to sink.
+    using fp_stream_t = ecl::stream<4, void(*)(const char* const, std::size_t)>;
+
+    fp_stream_t st(function_sink);
+    st << "ab" << "cdefgh";
+    st.flush();
+
+    BOOST_CHECK(function_sink_out == "abcdefgh");
+
+    fp_stream_t empty;
+    empty << "abcdefgh";
+    empty.flush();
+
+    BOOST_CHECK(function_sink_out == "abcdefgh");
+
+    // Empty stream calls default callback, as it always did, other sinks
+    // only get data.
+    std::size_t calls = 0;
+    ecl::stream<4> cb_stream([&calls](const char* const, std::size_t size)
+    {
+        calls += (0 == size) ? 1 : 0;
+    });
+    cb_stream.flush();
+    BOOST_CHECK(1 == calls);
+
+    struct count_sink
+    {
+        void operator() (const char* const, std::size_t)
+        {
+            ++*m_calls;
+        }
+
+        std::size_t* m_calls;
+    };
+
+    ecl::stream<4, count_sink> count_stream(count_sink { &calls });
+    count_stream.flush();
+    BOOST_CHECK(1 == calls);
+    // Methods of stateful sink share its state.
+    struct offset_sink
+    {
+        void operator() (const char* const, std::size_t size)
+        {
+            m_offset += size;
+        }
+
+        bool send_static(const char* const, std::size_t size)
+        {
+            m_offset += size;
+            return 4 == m_offset;
+        }
+
+        std::size_t m_offset { 0 };
+    };
+
+    ecl::web::send_callback_t cb(offset_sink {});
+
+    cb("ab", 2);
+    cb("c", 1);
+    BOOST_CHECK(cb.send_static("d", 1));
+    BOOST_CHECK(!cb.send_file(0, 0, 1));
+
+    // Copies copy the sink, as std::function does.
+    ecl::web::send_callback_t copy(cb);
+    copy("e", 1);
+    BOOST_CHECK(!copy.send_static("f", 1));
+    BOOST_CHECK(!cb.send_static("g", 1));
+
+    copy = ecl::web::send_callback_t(offset_sink {});
+    BOOST_CHECK(!copy.send_static("abc", 3));
+    BOOST_CHECK(copy.send_static("d", 1));
+
+    // Empty callbacks drop data.
+    ecl::web::send_callback_t empty_cb;
+    ecl::web::send_callback_t null_cb(static_cast<void(*)(const char* const, std::size_t)>(nullptr));
+
+    BOOST_CHECK(!empty_cb);
+    BOOST_CHECK(!null_cb);
+    empty_cb("a", 1);
+    null_cb("a", 1);
+    BOOST_CHECK(!null_cb.send_static("a", 1));
+
+    ecl::web::send_callback_t fp_cb(function_sink);
+    BOOST_CHECK(static_cast<bool>(fp_cb));
+    fp_cb("ij", 2);
+    BOOST_CHECK(function_sink_out == "abcdefghij");
+}
+
+BOOST_FIXTURE_TEST_CASE( event_loop_case, web_fixture )
+{
+    ecl::web::event_loop<server_t, 64> loop(srv);
+
+    BOOST_REQUIRE(loop.open("0"));
+    BOOST_REQUIRE(0 != loop.port());
+
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(loop.port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(-1 != fd);
+    BOOST_REQUIRE(0 == connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    // Request is larger than receive buffer of the loop.
+    std::string rq("GET /text HTTP/1.1\r\nHost: localhost\r\nX-Padding: ");
+    rq += std::string(100, 'x') + "\r\nConnection: close\r\n\r\n";
+    BOOST_REQUIRE(rq.size() == static_cast<std::size_t>(send(fd, rq.data(), rq.size(), 0)));
+
+    std::string out;
+    char        buf[256];
+
+    for(std::size_t i = 0; i < 100; ++i)
+    {
+        BOOST_REQUIRE(loop.run_once(10));
+
+        ssize_t size = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if(0 == size)
+        {
+            break;
+        }
+
+        if(size > 0)
+        {
+            out.append(buf, static_cast<std::size_t>(size));
+        }
+    }
+
+    close(fd);
+
+    BOOST_CHECK(0 == out.find("HTTP/1.1 200"));
+    BOOST_CHECK(out.substr(out.size() - 4) == "text");
+    BOOST_CHECK(1 == res.m_calls);
+}
+
+BOOST_AUTO_TEST_CASE( server_shards_case )
+{
+    struct counter_resource : public server_t::i_resource_t
+    {
+        virtual ~counter_resource()                            noexcept override
+        {}
+
+        virtual ecl::web::status_code on_request(
+                server_t::stream_t&        st,
+                ecl::web::i_request_cache& c
+            )                                                  noexcept override
+        {
+            ++m_calls;
+
+            ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+            ecl::web::set_content_length_header(st, 4);
+            st << "\r\n" << "text";
+            st.flush();
+
+            return ecl::web::status_code::OK;
+        }
+
+        std::atomic<std::size_t> m_calls { 0 };
+    };
+
+    static ecl::web::server_shards<server_t, 2, 64> shards;
+
+    counter_resource res;
+    BOOST_REQUIRE(shards.tables().attach_resource("/count", res));
+
+    BOOST_REQUIRE(shards.start("0", 10));
+    BOOST_REQUIRE(0 != shards.port());
+
+    auto request = []()
+    {
+        sockaddr_in addr {};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(shards.port());
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        BOOST_REQUIRE(-1 != fd);
+
+        timeval timeout { 1, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        BOOST_REQUIRE(0 == connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+        std::string rq("GET /count HTTP/1.1\r\nConnection: close\r\n\r\n");
+        BOOST_REQUIRE(rq.size() == static_cast<std::size_t>(send(fd, rq.data(), rq.size(), 0)));
+
+        std::string out;
+        char        buf[256];
+        ssize_t     size;
+
+        while((size = recv(fd, buf, sizeof(buf), 0)) > 0)
+        {
+            out.append(buf, static_cast<std::size_t>(size));
+        }
+
+        close(fd);
+
+        BOOST_CHECK(0 == out.find("HTTP/1.1 200"));
+        BOOST_CHECK(out.substr(out.size() - 4) == "text");
+    };
+
+    const std::size_t requests = 8;
+
+    for(std::size_t i = 0; i < requests; ++i)
+    {
+        request();
+    }
+
+    shards.stop();
+
+    BOOST_CHECK(requests == res.m_calls);
+    BOOST_CHECK(0 == shards.port());
+
+    // Stopped shards serve again after start.
+    BOOST_REQUIRE(shards.start("0", 10));
+    request();
+    shards.stop();
+
+    BOOST_CHECK(requests + 1 == res.m_calls);
+}
+
+// Large file must not go through fixed send buffer of default sink.
+BOOST_AUTO_TEST_CASE( file_resource_socket_case )
+{
+    char dir[] = "/tmp/ecl_web_files_XXXXXX";
+    BOOST_REQUIRE(nullptr != mkdtemp(dir));
+
+    const std::string root(dir);
+    std::string       data(8 * 1024 * 1024, 0);
+
+    for(std::size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = static_cast<char>('a' + i % 26);
+    }
+
+    write_file(root + "/large.bin", data);
+
+    static ecl::web::server_shards<server_t, 1, 512, 1024> shards;
+
+    ecl::web::file_resource<server_t::stream_t> files(root.c_str());
+    BOOST_REQUIRE(shards.tables().attach_resource("/files/*", files));
+    BOOST_REQUIRE(shards.start("0", 10));
+
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(shards.port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(-1 != fd);
+
+    timeval timeout { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    BOOST_REQUIRE(0 == connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    std::string rq("GET /files/large.bin HTTP/1.1\r\nConnection: close\r\n\r\n");
+    BOOST_REQUIRE(rq.size() == static_cast<std::size_t>(send(fd, rq.data(), rq.size(), 0)));
+
+    std::string out;
+    char        buf[65536];
+    ssize_t     size;
+
+    while((size = recv(fd, buf, sizeof(buf), 0)) > 0)
+    {
+        out.append(buf, static_cast<std::size_t>(size));
+    }
+
+    close(fd);
+    shards.stop();
+
+    BOOST_CHECK(0 == out.find("HTTP/1.1 200"));
+    BOOST_REQUIRE(out.size() > data.size());
+    BOOST_CHECK(out.substr(out.size() - data.size()) == data);
+
+    std::remove((root + "/large.bin").c_str());
+    rmdir(dir);
+}
+
+#define WEB_TEST_LARGE_HEADERS "Content-Length:4194304\r\nContent-Type:image/png\r\n\r\n"
+
+struct large_data
+{
+    static constexpr char mime_type[] = "image/png";
+
+    static constexpr std::size_t headers_size  = sizeof(WEB_TEST_LARGE_HEADERS) - 1;
+    static constexpr std::size_t size          = 4 * 1024 * 1024;
+    static constexpr std::size_t response_size = headers_size + size;
+
+    static constexpr std::size_t length_size       = 24;
+    static constexpr std::size_t validators_offset = headers_size - 2;
+
+    static unsigned char              response[response_size];
+    static const unsigned char* const data;
+
+    static constexpr char etag[] = "\"large\"";
+};
+
+constexpr char             large_data::mime_type[];
+unsigned char              large_data::response[];
+const unsigned char* const large_data::data = large_data::response + large_data::headers_size;
+constexpr char             large_data::etag[];
+
+// Static data, that socket doesn't take at once, is kept until it does,
+// not copied to fixed send buffer.
+BOOST_AUTO_TEST_CASE( static_resource_socket_case )
+{
+    std::memcpy(large_data::response, WEB_TEST_LARGE_HEADERS, large_data::headers_size);
+
+    for(std::size_t i = 0; i < large_data::size; ++i)
+    {
+        large_data::response[large_data::headers_size + i] = static_cast<unsigned char>('a' + i % 26);
+    }
+
+    static ecl::web::server_shards<server_t, 1, 512, 1024> shards;
+
+    server_t::static_resource_t<large_data> large;
+    BOOST_REQUIRE(shards.tables().attach_resource("/large", large));
+    BOOST_REQUIRE(shards.start("0", 10));
+
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(shards.port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(-1 != fd);
+
+    timeval timeout { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    BOOST_REQUIRE(0 == connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    std::string rq("GET /large HTTP/1.1\r\nConnection: close\r\n\r\n");
+    BOOST_REQUIRE(rq.size() == static_cast<std::size_t>(send(fd, rq.data(), rq.size(), 0)));
+
+    // Slow reader: socket buffers are full, when server writes response.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::string out;
+    char        buf[65536];
+    ssize_t     size;
+
+    while((size = recv(fd, buf, sizeof(buf), 0)) > 0)
+    {
+        out.append(buf, static_cast<std::size_t>(size));
+    }
+
+    close(fd);
+    shards.stop();
+
+    const std::string data(reinterpret_cast<const char*>(large_data::data), large_data::size);
+
+    BOOST_CHECK(0 == out.find("HTTP/1.1 200"));
+    BOOST_REQUIRE(out.size() > data.size());
+    BOOST_CHECK(out.substr(out.size() - data.size()) == data);
+}
+
+BOOST_AUTO_TEST_CASE( session_push_socket_case )
+{
+    // Push is larger than socket buffers (up to 4 MB with default
+    // tcp_wmem), but fits send buffer of the loop.
+    using push_server_t = ecl::web::server<512, 128, 8, 8, 8, 1>;
+    using loop_t        = ecl::web::event_loop<push_server_t, 512, 8 * 1024 * 1024>;
+
+    push_server_t push_srv;
+    ecl::web::sse_resource<push_server_t::stream_t, 1, 4096> sse;
+    push_srv.attach_resource("/events", sse);
+
+    std::unique_ptr<loop_t> loop(new loop_t(push_srv));
+    BOOST_REQUIRE(loop->open("0"));
+
+    sockaddr_in addr {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(loop->port());
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(-1 != fd);
+
+    // Small receive window, so the push doesn't fit socket buffers.
+    int rcvbuf = 4096;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    BOOST_REQUIRE(0 == connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    std::string rq("GET /events HTTP/1.1\r\n\r\n");
+    BOOST_REQUIRE(rq.size() == static_cast<std::size_t>(send(fd, rq.data(), rq.size(), 0)));
+
+    for(std::size_t i = 0; (i < 100) && (0 == sse.subscribers_count()); ++i)
+    {
+        BOOST_REQUIRE(loop->run_once(10));
+    }
+    BOOST_REQUIRE(1 == sse.subscribers_count());
+
+    // Published outside of socket events, loop never ticks.
+    const std::string data(6 * 1024 * 1024, 'x');
+    sse.publish(data.c_str());
+
+    const std::string event("data:" + data + "\n\n");
+
+    std::string out;
+    char        buf[65536];
+
+    for(std::size_t i = 0; (i < 500) && (out.size() < event.size()); ++i)
+    {
+        BOOST_REQUIRE(loop->run_once(10));
+
+        ssize_t size;
+        while((size = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        {
+            out.append(buf, static_cast<std::size_t>(size));
+        }
+    }
+
+    close(fd);
+
+    BOOST_CHECK(0 == out.find("HTTP/1.1 200"));
+    BOOST_REQUIRE(out.size() > event.size());
+    BOOST_CHECK(out.substr(out.size() - event.size()) == event);
+}
+
+BOOST_AUTO_TEST_CASE( zero_copy_case )
+{
+    using zc_server_t = ecl::web::server
+                        <
+                              512, 128, 8, 8, 8, 1, 8
+                            , ecl::web::zero_copy_request_cache
+                        >;
+
+    struct zc_resource : public zc_server_t::i_resource_t
+    {
+        virtual ~zc_resource()                                 noexcept override
+        {}
+
+        virtual ecl::web::status_code on_request(
+                zc_server_t::stream_t&     st,
+                ecl::web::i_request_cache& c
+            )                                                  noexcept override
+        {
+            m_body = c.get_body().first;
+
+            ecl::web::write_status_line(st, c.get_ver(), ecl::web::status_code::OK);
+            st << "\r\n";
+            st.flush();
+
+            return ecl::web::status_code::OK;
+        }
+
+        const char* m_body { nullptr };
+    };
+
+    std::string out;
+    zc_server_t srv([&out](const char* const buf, std::size_t size)
+    {
+        out.append(buf, size);
+    });
+
+    zc_resource res;
+    srv.attach_resource("/zc", res);
+
+    char rq[] = "POST /zc HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody";
+    std::size_t rq_size = sizeof(rq) - 1;
+
+    srv.process_request(rq, 10);
+    BOOST_CHECK(rq == srv.get_pending().first);
+    BOOST_CHECK(10 == srv.get_pending().second);
+
+    srv.process_request(rq + 10, rq_size - 10);
+
+    BOOST_CHECK(0 == out.find("HTTP/1.1 200"));
+    BOOST_CHECK(rq + rq_size - 4 == res.m_body);
+    BOOST_CHECK(0 == srv.get_pending().second);
+
+    // Pipelined requests and start of the next one in one receive buffer.
+    const std::string rq_1("POST /zc HTTP/1.1\r\nContent-Length: 3\r\n\r\none");
+    const std::string rq_2("POST /zc HTTP/1.1\r\nContent-Length: 3\r\n\r\ntwo");
+    const std::size_t split = 20;
+
+    char buf[256];
+    std::size_t received = 0;
+
+    auto receive = [&](const std::string& data)
+    {
+        std::memcpy(buf + received, data.data(), data.size());
+        srv.process_request(buf + received, data.size());
+        received += data.size();
+    };
+
+    auto responses = [&out]()
+    {
+        std::size_t count = 0;
+
+        for(std::size_t pos = out.find("HTTP/1.1 200"); std::string::npos != pos;
+            pos = out.find("HTTP/1.1 200", pos + 1))
+        {
+            ++count;
+        }
+
+        return count;
+    };
+
+    out.clear();
+    receive(rq_1 + rq_2 + rq_2.substr(0, split));
+
+    BOOST_CHECK(2 == responses());
+    BOOST_CHECK(buf + received - split == srv.get_pending().first);
+    BOOST_CHECK(split == srv.get_pending().second);
+
+    // Rest of the request is received right after pending data.
+    receive(rq_2.substr(split));
+
+    BOOST_CHECK(3 == responses());
+    BOOST_CHECK(buf + received - 3 == res.m_body);
+    BOOST_CHECK(0 == srv.get_pending().second);
+
+    // Nothing is pending, buffer is reused from its beginning.
+    received = 0;
+    receive(rq_1);
+
+    BOOST_CHECK(4 == responses());
+    BOOST_CHECK(buf + rq_1.size() - 3 == res.m_body);
+    BOOST_CHECK(std::string("one") == std::string(res.m_body, 3));
+    BOOST_CHECK(0 == srv.get_pending().second);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif // ECL_TEST_WEB_HPP
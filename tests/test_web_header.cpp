@@ -0,0 +1,19 @@
+#define BOOST_TEST_DYN_LINK
+
+// ecl/web.hpp must compile with nothing included before it.
+#include <ecl/web.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE( web_header_case )
+{
+    using server_t = ecl::web::server<512, 128, 8, 8, 8, 2>;
+
+    server_t srv;
+    server_t::connection_t* c = srv.open([](const char* const, std::size_t) {});
+
+    BOOST_REQUIRE(nullptr != c);
+
+    c->restart();
+    srv.close(c);
+}
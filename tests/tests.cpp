@@ -10,3 +10,4 @@
 #include "test_fsm.hpp"
 #include "test_bitfield.hpp"
 #include "test_json.hpp"
+#include "test_web.hpp"